@@ -0,0 +1,124 @@
+// Микробенчмарки раскладки Message<N> и обращения к транспорту. Собираются с
+// cmake -DEASYUDP_BENCH=ON -DCMAKE_BUILD_TYPE=Release; печатают нс на операцию.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <message.h>
+#include <loopbackTransport.h>
+#include <udptransmitter.h>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	volatile uint64_t sink; // не даёт компилятору выбросить измеряемую работу
+
+	double nsPer(Clock::time_point start, size_t operations)
+	{
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(operations);
+	}
+
+	// Очередь коротких (16 байт) сообщений в Message<1024>: копирование в кольцо
+	// на 4 МБ и обратно, как в очереди между потоками
+	double messageRing()
+	{
+		constexpr size_t RING_BYTES = 4 << 20;
+		constexpr size_t OPERATIONS = 1 << 22;
+		std::vector<Message<1024>> ring(RING_BYTES / sizeof(Message<1024>));
+		Message<1024> in;
+		Message<1024> out;
+		uint64_t sum = 0;
+		Clock::time_point start = Clock::now();
+		for(size_t i = 0; i < OPERATIONS; ++i)
+		{
+			in.clear();
+			in.push(static_cast<uint64_t>(i));
+			in.push(static_cast<uint64_t>(i * 3));
+			// Читатель отстаёт от писателя на половину кольца, поэтому записи не выбрасываются
+			ring[i % ring.size()] = in;
+			out = ring[(i + ring.size() / 2) % ring.size()];
+			if(out.size() > 0)
+				sum += out.read<uint64_t>();
+		}
+		double result = nsPer(start, OPERATIONS);
+		sink = sum;
+		return result;
+	}
+
+	// Чтение первого поля из 16k сообщений (16 МБ) в случайном порядке: заголовок
+	// Message и начало данных должны приходить одним промахом кэша
+	double firstFieldRead()
+	{
+		constexpr size_t MESSAGES = 16384;
+		constexpr size_t ROUNDS = 64;
+		std::vector<Message<1024>> messages(MESSAGES);
+		for(size_t i = 0; i < MESSAGES; ++i)
+			messages[i].push(static_cast<uint64_t>(i));
+		std::vector<uint32_t> order(MESSAGES);
+		std::iota(order.begin(), order.end(), 0);
+		std::shuffle(order.begin(), order.end(), std::mt19937(1));
+
+		uint64_t sum = 0;
+		Clock::time_point start = Clock::now();
+		for(size_t round = 0; round < ROUNDS; ++round)
+			for(uint32_t index : order)
+			{
+				Message<1024>& message = messages[index];
+				message.setReadPtr(0);
+				sum += message.read<uint64_t>();
+			}
+		double result = nsPer(start, MESSAGES * ROUNDS);
+		sink = sum;
+		return result;
+	}
+
+	// Отправка и приём 16-байтного сообщения через 64 пары передатчиков в памяти
+	double loopbackTransmitters()
+	{
+		constexpr size_t PAIRS = 64;
+		constexpr size_t ROUNDS = 4096;
+		LoopbackNetwork network;
+		std::vector<std::unique_ptr<LoopbackTransport>> transports;
+		std::vector<UDPTransmitter> senders;
+		std::vector<UDPTransmitter> receivers;
+		senders.reserve(PAIRS);
+		receivers.reserve(PAIRS);
+		for(size_t i = 0; i < PAIRS; ++i)
+		{
+			IPAddress from(10, 0, 0, static_cast<uint8_t>(2 * i + 1));
+			IPAddress to(10, 0, 0, static_cast<uint8_t>(2 * i + 2));
+			transports.push_back(std::make_unique<LoopbackTransport>(network, from, 45088));
+			senders.emplace_back(transports.back().get(), "bench");
+			senders.back().setTargetIP(to);
+			transports.push_back(std::make_unique<LoopbackTransport>(network, to, 45088));
+			receivers.emplace_back(transports.back().get(), "bench");
+		}
+
+		uint8_t payload[16] = {};
+		uint8_t buffer[64];
+		uint64_t received = 0;
+		Clock::time_point start = Clock::now();
+		for(size_t round = 0; round < ROUNDS; ++round)
+			for(size_t i = 0; i < PAIRS; ++i)
+			{
+				senders[i].sendData(payload, sizeof(payload));
+				received += receivers[i].receiveData(buffer, sizeof(buffer)).dataSize;
+			}
+		double result = nsPer(start, PAIRS * ROUNDS);
+		sink = received;
+		return result;
+	}
+}
+
+int main()
+{
+	std::printf("Message<1024> ring copy, 16-byte messages: %.1f ns/msg\n", messageRing());
+	std::printf("Message<1024> first field, random order:   %.1f ns/read\n", firstFieldRead());
+	std::printf("UDPTransmitter send+receive, 64 loopback pairs: %.1f ns/msg\n", loopbackTransmitters());
+	return 0;
+}
@@ -3,6 +3,7 @@
 #include <string>
 #include <thread>
 
+#include <messageSchema.h>
 #include <udptransmitter.h>
 
 struct exempleStruct {
@@ -10,6 +11,10 @@ struct exempleStruct {
   long long b;
 };
 
+template <>
+struct MessageSchema<exempleStruct>
+    : Schema<&exempleStruct::a, &exempleStruct::b> {};
+
 int main() {
   UDPTransmitter transmitter(45089, "testing");
 
@@ -18,7 +23,7 @@ int main() {
   while (true) {
     msg.push("можно записать строку");
     msg.push((uint32_t)12542);
-    msg.push(exempleStruct{124, 15125});
+    msg.pushPacked(exempleStruct{124, 15125});
     transmitter.sendData(msg);
 
     msg.clear();
@@ -32,7 +37,7 @@ int main() {
       std::cout << "data:" << std::endl;
       std::cout << msg.readString() << std::endl;
       std::cout << msg.read<uint32_t>() << std::endl;
-      exempleStruct ex = msg.read<exempleStruct>();
+      exempleStruct ex = msg.readPacked<exempleStruct>();
       std::cout << ex.a << std::endl;
       std::cout << ex.b << std::endl;
     }
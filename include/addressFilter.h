@@ -0,0 +1,55 @@
+#if !defined ADDRESS_FILTER_H
+#define ADDRESS_FILTER_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <vector>
+
+#include <subnet.h>
+
+enum class FilterAction : uint8_t
+{
+	DENY,
+	ALLOW
+};
+
+// Список разрешённых/запрещённых подсетей. Действует правило с самым длинным
+// префиксом (из одинаковых подсетей — добавленное последним), адреса вне всех
+// правил получают действие по умолчанию.
+// Правила компилируются в отсортированный массив непересекающихся интервалов,
+// проверка — двоичный поиск по нему без ветвлений.
+class AddressFilter
+{
+	struct Rule
+	{
+		Subnet subnet;
+		FilterAction action;
+	};
+
+	FilterAction defaultAction_;
+	std::vector<Rule> rules_;
+	// Интервал i — адреса [starts_[i], starts_[i + 1]) в host-endian, starts_[0] == 0
+	mutable std::vector<uint32_t> starts_;
+	mutable std::vector<FilterAction> actions_;
+	mutable bool dirty_ = true;
+
+	void compile() const;
+
+public:
+	explicit AddressFilter(FilterAction defaultAction = FilterAction::DENY);
+
+	void allow(Subnet subnet) { add(subnet, FilterAction::ALLOW); }
+	void deny(Subnet subnet) { add(subnet, FilterAction::DENY); }
+	void add(Subnet subnet, FilterAction action);
+	void clear();
+
+	// Первая проверка после изменения правил перестраивает интервалы
+	FilterAction check(IPAddress address) const;
+	bool allows(IPAddress address) const { return check(address) == FilterAction::ALLOW; }
+
+	FilterAction defaultAction() const { return defaultAction_; }
+	size_t ruleCount() const { return rules_.size(); }
+	size_t intervalCount() const;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#if !defined BYTE_ORDER_H
+#define BYTE_ORDER_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <array>
+#include <bit>
+#include <span>
+#include <utility>
+#include <cstring>
+#include <type_traits>
+#include <stdexcept>
+
+
+static_assert(__cplusplus >= 202002L,
+"This library does not support c++ older then c++20!"
+);
+
+static_assert
+(
+	std::endian::native == std::endian::little ||
+	std::endian::native == std::endian::big,
+	"This library does not support mixed-endian (PDP-endian) architectures!"
+);
+
+
+template<typename T>
+constexpr T reverseByteOrder(T val)
+{
+	static_assert(std::is_trivially_copyable<T>(), "template<typename T> static constexpr T reverseByteOrder(T) T shoud be trivially copyable (POD-like)");
+	std::array<uint8_t, sizeof(T)> res = std::bit_cast<std::array<uint8_t, sizeof(T)>>(val);
+	for(size_t i = 0; i < sizeof(T)/2; ++i)
+	{
+		std::swap(res[i], res[sizeof(T)-1-i]);
+	}
+	return std::bit_cast<T>(res);
+}
+
+template<typename T>
+constexpr T hton(T val)
+{
+	static_assert(std::is_trivially_copyable<T>(), "template<typename T> static constexpr T hton(T) T shoud be trivially copyable (POD-like)");
+	if(std::endian::native == std::endian::big)
+		return val;
+	return reverseByteOrder(val);
+}
+
+template<typename T>
+constexpr T ntoh(T val)
+{
+	static_assert(std::is_trivially_copyable<T>(), "template<typename T> static constexpr T ntoh(T) T shoud be trivially copyable (POD-like)");
+	if(std::endian::native == std::endian::big)
+		return val;
+	return reverseByteOrder(val);
+}
+
+// Массовый разворот порядка байт: count элементов размером elemSize (1, 2, 4 или 8 байт).
+// dst может совпадать с src (преобразование на месте), частичное перекрытие не допускается.
+// Использует SSSE3/AVX2 (выбор при первом вызове) или NEON, иначе скалярный цикл.
+void reverseByteOrderBulk(void* dst, const void* src, size_t count, size_t elemSize) noexcept;
+
+// Преобразование блока из count элементов размером elemSize в сетевой порядок байт (и обратно)
+inline void htonBulk(void* dst, const void* src, size_t count, size_t elemSize) noexcept
+{
+	if constexpr (std::endian::native == std::endian::big)
+	{
+		if(dst != src)
+			memcpy(dst, src, count * elemSize);
+	}
+	else
+		reverseByteOrderBulk(dst, src, count, elemSize);
+}
+
+inline void ntohBulk(void* dst, const void* src, size_t count, size_t elemSize) noexcept
+{
+	htonBulk(dst, src, count, elemSize); // преобразование симметрично
+}
+
+template<typename T>
+void htonArray(std::span<const T> src, std::span<T> dst)
+{
+	static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "template<typename T> void htonArray(std::span<const T>, std::span<T>) T should be arithmetic or enum");
+	if(dst.size() < src.size())
+		throw std::length_error("htonArray(std::span<const T>, std::span<T>) dst must be at least as large as src");
+	htonBulk(dst.data(), src.data(), src.size(), sizeof(T));
+}
+
+template<typename T>
+void ntohArray(std::span<const T> src, std::span<T> dst)
+{
+	htonArray(src, dst); // преобразование симметрично
+}
+
+template<typename T>
+void htonArray(std::span<T> data)
+{
+	htonArray(std::span<const T>(data), data);
+}
+
+template<typename T>
+void ntohArray(std::span<T> data)
+{
+	htonArray(std::span<const T>(data), data);
+}
+
+#endif
@@ -0,0 +1,123 @@
+#if !defined CAPTURE_H
+#define CAPTURE_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <string>
+#include <optional>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <netaddress.h>
+#include <udpsocket.h>
+
+// Формат файла записи (все числа в сетевом порядке):
+//   заголовок 32 байта: "EUDPCAP\0", версия u32, размер заголовка u32,
+//   конец данных u64 (обновляется после каждой записи), резерв u64;
+//   записи: длина данных u32, порт u16, резерв u16, время u64 (нс от эпохи
+//   system_clock), адрес 16 байт (IPv4 — IPv4-mapped), данные, выравнивание до 8 байт.
+// Файл отображается в память и растёт кусками, поэтому запись одной датаграммы —
+// это копирование в память без системных вызовов.
+// POSIX: адресное пространство под весь файл (maxFileSize) резервируется сразу, куски
+// отображаются в него по фиксированным адресам, и уже записанное не переотображается.
+// Следующий кусок добавляет фоновый поток, когда запись проходит половину последнего;
+// если он не успел, запись растит файл сама (ftruncate + mmap куска, см. growthStalls()).
+// Windows: рост — переотображение всего файла на потоке записи, раз на chunkSize байт.
+
+struct CaptureRecord
+{
+	std::chrono::system_clock::time_point timestamp;
+	Endpoint peer;
+	const uint8_t* data; // действительны, пока жив CaptureReader
+	size_t size;
+};
+
+class CaptureWriter
+{
+	std::string path_;
+	intptr_t file_ = -1;
+	intptr_t mapping_ = 0; // только Windows
+	uint8_t* data_ = nullptr;
+	size_t reserved_ = 0;  // только POSIX: зарезервированное адресное пространство
+	std::atomic<size_t> mapped_{ 0 };
+	size_t end_ = 0;
+	size_t chunkSize_;
+	uint64_t records_ = 0;
+	uint64_t stalls_ = 0;
+
+	// Фоновый рост (POSIX); growMutex_ защищает отображение от одновременного роста
+	std::mutex growMutex_;
+	std::condition_variable growWake_;
+	std::atomic<bool> growPending_{ false };
+	bool stopping_ = false;
+	std::thread grower_;
+
+	bool extend(size_t required); // под growMutex_
+	bool growNow(size_t required);
+	void requestGrowth();
+	void growLoop();
+	bool map(size_t size);
+	void unmap();
+
+public:
+	static constexpr size_t HEADER_SIZE = 32;
+	static constexpr size_t RECORD_HEADER_SIZE = 32;
+	static constexpr size_t DEFAULT_MAX_FILE_SIZE = sizeof(void*) >= 8 ? size_t(1) << 40 : size_t(1) << 30;
+
+	// Создаёт (перезаписывает) файл; при ошибке — std::runtime_error.
+	// chunkSize округляется вверх до 64 КиБ; запись сверх maxFileSize не удаётся (только POSIX).
+	explicit CaptureWriter(const std::string& path, size_t chunkSize = 64 * 1024 * 1024, size_t maxFileSize = DEFAULT_MAX_FILE_SIZE);
+	~CaptureWriter();
+
+	CaptureWriter(const CaptureWriter&) = delete;
+	CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+	// false — не удалось увеличить файл
+	bool write(const Endpoint& peer, const uint8_t* data, size_t size,
+		std::chrono::system_clock::time_point timestamp = std::chrono::system_clock::now());
+	bool write(const ReceiveInfo& info, const uint8_t* data,
+		std::chrono::system_clock::time_point timestamp = std::chrono::system_clock::now())
+	{
+		return write(info.remoteEndpoint(), data, info.dataSize, timestamp);
+	}
+
+	// Обрезает файл до записанных данных; после close запись невозможна
+	void close();
+
+	uint64_t recordCount() const { return records_; }
+	size_t bytesWritten() const { return end_; }
+	bool isOpen() const { return data_ != nullptr; }
+	// Сколько раз запись сама растила файл (на Windows — каждый рост)
+	uint64_t growthStalls() const { return stalls_; }
+};
+
+class CaptureReader
+{
+	intptr_t file_ = -1;
+	intptr_t mapping_ = 0; // только Windows
+	const uint8_t* data_ = nullptr;
+	size_t size_ = 0;
+	size_t end_ = 0;
+	size_t offset_ = 0;
+
+	void release();
+
+public:
+	// Открывает файл записи; при ошибке или чужом формате — std::runtime_error
+	explicit CaptureReader(const std::string& path);
+	~CaptureReader();
+
+	CaptureReader(const CaptureReader&) = delete;
+	CaptureReader& operator=(const CaptureReader&) = delete;
+
+	// Следующая запись или nullopt в конце (обрезанная запись считается концом)
+	std::optional<CaptureRecord> next();
+	// Время следующей записи, не сдвигая позицию
+	std::optional<std::chrono::system_clock::time_point> peekTimestamp() const;
+	void rewind() { offset_ = CaptureWriter::HEADER_SIZE; }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#if !defined CHANNEL_MUX_H
+#define CHANNEL_MUX_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <udpsocket.h>
+#include <snapshotStore.h>
+#include <transportHandle.h>
+
+// Несколько каналов (magic-строк) на одном сокете. Входящий пакет отдаётся каналу
+// с самой длинной совпавшей magic-строкой: для каждой встречающейся длины строк
+// строится совершенная хеш-таблица, поэтому поиск — один хеш и один memcmp на длину,
+// независимо от числа каналов. Формат пакета совпадает с UDPTransmitter без
+// расширенного заголовка: magic-строка, затем данные.
+class ChannelMux
+{
+public:
+	// data — данные после magic-строки, действительны до возврата из обработчика
+	using Handler = std::function<void(const uint8_t* data, size_t size, const ReceiveInfo& info)>;
+
+private:
+	struct Channel
+	{
+		std::string magic;
+		Handler handler;
+		uint64_t received = 0;
+	};
+
+	struct LengthGroup
+	{
+		size_t length;
+		uint64_t seed;
+		unsigned shift;
+		std::vector<int32_t> slots; // индекс канала или -1
+	};
+
+	TransportHandle<UDPSocket> sock_;
+	std::vector<Channel> channels_;
+	std::vector<LengthGroup> groups_; // по убыванию длины
+	std::vector<uint8_t> recvBuf_;
+	uint64_t unmatched_ = 0;
+
+	UDPSocket& sock()
+	{
+		return *sock_;
+	}
+
+	void rebuild();
+	ssize_t sendResult(std::variant<size_t, UDPError> rc, size_t size);
+public:
+	ChannelMux(uint16_t port); // host-endian
+	ChannelMux(UDPSocket* sock);
+
+	ChannelMux(ChannelMux&&) noexcept = default;
+	ChannelMux& operator=(ChannelMux&&) noexcept = default;
+	ChannelMux(const ChannelMux&) = delete;
+	ChannelMux& operator=(const ChannelMux&) = delete;
+
+	// Возвращает номер канала; исключение, если такая magic-строка уже есть или пуста
+	size_t addChannel(std::string magic, Handler handler);
+
+	// Канал, пакеты которого сохраняются в store как последнее значение от каждого
+	// отправителя (ключ — remoteEndpoint() и номер канала); store должен пережить ChannelMux
+	size_t addSnapshotChannel(std::string magic, SnapshotStore& store);
+
+	// Канал, которому принадлежит пакет, или -1
+	int32_t lookup(const uint8_t* data, size_t size) const;
+
+	// Вычитывает до maxPackets пакетов и раздаёт их каналам; возвращает число разданных
+	size_t poll(size_t maxPackets = 64);
+
+	ssize_t send(size_t channel, const uint8_t* data, size_t size, IPAddress ip);
+	ssize_t send(size_t channel, const uint8_t* data, size_t size, const Endpoint& peer);
+
+	template <size_t N>
+	ssize_t send(size_t channel, const Message<N>& data, IPAddress ip)
+	{
+		return send(channel, data.data(), data.size(), ip);
+	}
+
+	size_t channelCount() const { return channels_.size(); }
+	const std::string& magic(size_t channel) const { return channels_.at(channel).magic; }
+	uint64_t receivedCount(size_t channel) const { return channels_.at(channel).received; }
+	uint64_t unmatchedCount() const { return unmatched_; } // пакеты без подходящего канала
+};
+
+#endif
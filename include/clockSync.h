@@ -0,0 +1,73 @@
+#if !defined CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <array>
+#include <chrono>
+
+// Оценка смещения и дрейфа часов узла по обменам запрос/ответ, как в NTP:
+// t1 — отправка запроса (наши часы), t2 — приём запроса и t3 — отправка ответа
+// (часы узла), t4 — приём ответа (наши часы). Из последних WINDOW обменов берётся
+// обмен с наименьшим RTT (меньше всего искажён очередями); по таким выборкам
+// за HISTORY интервалов дрейф оценивается методом наименьших квадратов.
+// Часы обеих сторон — steady_clock, у каждого узла своя эпоха.
+class ClockEstimator
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr size_t WINDOW = 8;
+	static constexpr size_t HISTORY = 16;
+	static constexpr size_t MIN_DRIFT_SAMPLES = 4;
+	static constexpr double MAX_DRIFT = 500e-6; // как в NTP: 500 ppm
+
+private:
+	struct Sample
+	{
+		int64_t local;  // середина обмена по нашим часам, нс
+		int64_t offset; // часы узла минус наши, нс
+		int64_t rtt;
+	};
+
+	std::array<Sample, WINDOW> window_{};
+	std::array<Sample, HISTORY> history_{};
+	size_t windowCount_ = 0;
+	size_t windowNext_ = 0;
+	size_t historyCount_ = 0;
+	size_t historyNext_ = 0;
+	int64_t lastSelected_ = INT64_MIN; // local последней выборки в истории
+	uint64_t samples_ = 0;
+	uint64_t rejected_ = 0;
+
+	// Прямая offset(local) = offset_ + drift_ * (local - reference_)
+	int64_t reference_ = 0;
+	double offset_ = 0;
+	double drift_ = 0;
+	int64_t rtt_ = 0;
+
+	void fit();
+
+public:
+	// Возвращает false для невозможного обмена (отрицательный RTT)
+	bool addSample(Clock::time_point t1, Clock::time_point t2, Clock::time_point t3, Clock::time_point t4);
+	void reset() { *this = ClockEstimator(); }
+
+	bool valid() const { return historyCount_ > 0; }
+
+	// Часы узла минус наши в момент local
+	std::chrono::nanoseconds offset(Clock::time_point local = Clock::now()) const;
+	// Относительная скорость часов узла: 1e-6 — спешат на 1 мкс в секунду
+	double drift() const { return drift_; }
+	// RTT выбранного обмена
+	std::chrono::nanoseconds rtt() const { return std::chrono::nanoseconds(rtt_); }
+
+	// Перевод меток времени узла в наши часы и обратно
+	Clock::time_point toLocal(Clock::time_point remote) const;
+	Clock::time_point toRemote(Clock::time_point local) const;
+
+	uint64_t sampleCount() const { return samples_; }
+	uint64_t rejectedCount() const { return rejected_; }
+};
+
+#endif
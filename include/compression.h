@@ -0,0 +1,25 @@
+#if !defined COMPRESSION_H
+#define COMPRESSION_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <optional>
+
+// Быстрое LZ-сжатие в блочном формате LZ4 (токен, литералы, 16-битное смещение).
+
+// Сжимает src в dst. Возвращает размер сжатых данных или 0, если результат
+// не помещается в dstCapacity (так удобно отбрасывать несжимаемые данные:
+// достаточно передать dstCapacity < srcSize).
+size_t lzCompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity) noexcept;
+
+// Распаковывает src в dst. Возвращает размер распакованных данных или
+// std::nullopt, если данные повреждены или не помещаются в dstCapacity.
+std::optional<size_t> lzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity) noexcept;
+
+// Максимальный размер сжатых данных для входа размером srcSize
+constexpr size_t lzCompressBound(size_t srcSize) noexcept
+{
+	return srcSize + srcSize / 255 + 16;
+}
+
+#endif
@@ -0,0 +1,15 @@
+#if !defined CRC32C_H
+#define CRC32C_H
+
+#include <inttypes.h>
+#include <cstddef>
+
+// CRC-32C (Castagnoli, полином 0x82F63B78). Инструкция crc32 SSE4.2 или ARMv8 CRC,
+// если доступна, иначе таблицы slicing-by-8.
+// Продолжение подсчёта: crc32c(b, sizeB, crc32c(a, sizeA)) == CRC от a и b подряд.
+uint32_t crc32c(const uint8_t* data, size_t size, uint32_t crc = 0) noexcept;
+
+// Размер контрольной суммы в конце датаграммы (big-endian)
+constexpr size_t CRC32C_SIZE = 4;
+
+#endif
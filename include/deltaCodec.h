@@ -0,0 +1,209 @@
+#if !defined DELTA_CODEC_H
+#define DELTA_CODEC_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+
+#include <message.h>
+#include <netaddress.h>
+
+// Дельта-кодирование кадров телеметрии: каждое поле кадра передаётся как zigzag-varint
+// разности с тем же полем предыдущего кадра. Формат кадра:
+//	varint (seq << 1 | keyframe), затем fieldCount varint-значений.
+// Ключевой кадр (keyframe) содержит абсолютные значения и отправляется каждые
+// keyframeInterval кадров, чтобы получатель восстанавливался после потери пакета.
+
+class DeltaEncoder
+{
+	std::vector<int64_t> previous_;
+	std::vector<int64_t> deltas_; // кадр до записи в msg: состояние меняется только после неё
+	uint16_t seq_;
+	uint32_t keyframeInterval_;
+	uint32_t sinceKeyframe_;
+public:
+	explicit DeltaEncoder(size_t fieldCount, uint32_t keyframeInterval = 32) :
+	previous_(fieldCount, 0), deltas_(fieldCount, 0), seq_(0), keyframeInterval_(keyframeInterval), sinceKeyframe_(keyframeInterval)
+	{}
+
+	size_t fieldCount() const
+	{
+		return previous_.size();
+	}
+
+	void forceKeyframe()
+	{
+		sinceKeyframe_ = keyframeInterval_;
+	}
+
+	// Если кадр не помещается в msg, бросает std::length_error до записи:
+	// msg и состояние кодера не меняются
+	template <size_t N>
+	void encode(std::span<const int64_t> frame, Message<N>& msg)
+	{
+		if(frame.size() != previous_.size())
+			throw std::invalid_argument("DeltaEncoder::encode(std::span<const int64_t>, Message<N>&) frame size must match fieldCount");
+
+		bool keyframe = sinceKeyframe_ >= keyframeInterval_;
+		uint32_t header = static_cast<uint32_t>(seq_) << 1 | (keyframe ? 1 : 0);
+		size_t size = varintSize(header);
+		for(size_t i = 0; i < frame.size(); ++i)
+		{
+			int64_t delta = keyframe ? frame[i] : static_cast<int64_t>(static_cast<uint64_t>(frame[i]) - static_cast<uint64_t>(previous_[i]));
+			deltas_[i] = delta;
+			size += varintSize((static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63)); // zigzag, как pushVarint
+		}
+		if(size > msg.space())
+			throw std::length_error("DeltaEncoder::encode(std::span<const int64_t>, Message<N>&) the frame size must be less than the remaining space");
+
+		msg.pushVarint(header);
+		for(int64_t delta : deltas_)
+			msg.pushVarint(delta);
+		std::copy(frame.begin(), frame.end(), previous_.begin());
+		sinceKeyframe_ = keyframe ? 1 : sinceKeyframe_ + 1;
+		++seq_;
+	}
+
+private:
+	static size_t varintSize(uint64_t value)
+	{
+		size_t size = 1;
+		for(; value >= 0x80; value >>= 7)
+			++size;
+		return size;
+	}
+};
+
+// Состояние узлов — в таблице из maxPeers слотов, выделенной в конструкторе: при
+// заполнении вытесняется узел, дольше всех не присылавший кадров. Слот занимает только
+// ключевой кадр, поэтому разностные кадры от неизвестных узлов таблицу не трогают.
+class DeltaDecoder
+{
+	struct PeerState
+	{
+		Endpoint peer{ IP_ANY, 0 }; // по адресу и порту: узлы одного хоста не мешают друг другу
+		uint64_t lastUsed = 0;
+		uint16_t lastSeq = 0;
+		bool used = false;
+		bool valid = false;
+	};
+
+	size_t fieldCount_;
+	std::vector<PeerState> peers_;
+	std::vector<int64_t> previous_; // maxPeers * fieldCount, по слоту на узел
+	uint64_t clock_ = 0;
+	size_t evicted_ = 0;
+
+	static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+	size_t find(const Endpoint& peer) const
+	{
+		for(size_t i = 0; i < peers_.size(); ++i)
+			if(peers_[i].used && peers_[i].peer == peer)
+				return i;
+		return NOT_FOUND;
+	}
+
+	size_t allocate(const Endpoint& peer)
+	{
+		size_t victim = 0;
+		for(size_t i = 0; i < peers_.size(); ++i)
+		{
+			if(!peers_[i].used)
+			{
+				victim = i;
+				break;
+			}
+			if(peers_[i].lastUsed < peers_[victim].lastUsed)
+				victim = i;
+		}
+		if(peers_[victim].used)
+			++evicted_;
+		peers_[victim] = PeerState{ peer, 0, 0, true, false };
+		return victim;
+	}
+public:
+	explicit DeltaDecoder(size_t fieldCount, size_t maxPeers = 64) :
+	fieldCount_(fieldCount), peers_(maxPeers), previous_(maxPeers * fieldCount, 0)
+	{
+		if(maxPeers == 0)
+			throw std::invalid_argument("DeltaDecoder::DeltaDecoder(size_t, size_t) maxPeers must be positive");
+	}
+
+	size_t fieldCount() const
+	{
+		return fieldCount_;
+	}
+
+	size_t maxPeers() const
+	{
+		return peers_.size();
+	}
+
+	size_t evictedCount() const // узлы, вытесненные из-за нехватки слотов
+	{
+		return evicted_;
+	}
+
+	void reset()
+	{
+		for(PeerState& state : peers_)
+			state.used = false;
+	}
+
+	void forget(const Endpoint& peer)
+	{
+		size_t i = find(peer);
+		if(i != NOT_FOUND)
+			peers_[i].used = false;
+	}
+
+	// Возвращает false, если кадр нельзя восстановить (пропущен предыдущий кадр,
+	// ещё не было ключевого кадра от этого узла). Состояние узла при этом
+	// сбрасывается до следующего ключевого кадра. peer — ReceiveInfo::remoteEndpoint().
+	// Если кадр обрезан (исключение из readVarint), состояние узла не меняется.
+	template <size_t N>
+	bool decode(Message<N>& msg, const Endpoint& peer, std::span<int64_t> frame)
+	{
+		if(frame.size() != fieldCount_)
+			throw std::invalid_argument("DeltaDecoder::decode(Message<N>&, const Endpoint&, std::span<int64_t>) frame size must match fieldCount");
+
+		uint32_t header = msg.template readVarint<uint32_t>();
+		bool keyframe = header & 1;
+		uint16_t seq = static_cast<uint16_t>(header >> 1);
+
+		size_t index = find(peer);
+		if(index == NOT_FOUND)
+		{
+			if(!keyframe)
+				return false;
+			index = allocate(peer);
+		}
+		PeerState& state = peers_[index];
+		state.lastUsed = ++clock_;
+		if(!keyframe && (!state.valid || seq != static_cast<uint16_t>(state.lastSeq + 1)))
+		{
+			state.valid = false;
+			return false;
+		}
+
+		// Кадр собирается в frame и попадает в состояние только целиком
+		int64_t* previous = previous_.data() + index * fieldCount_;
+		for(size_t i = 0; i < fieldCount_; ++i)
+		{
+			int64_t value = msg.template readVarint<int64_t>();
+			if(!keyframe)
+				value = static_cast<int64_t>(static_cast<uint64_t>(previous[i]) + static_cast<uint64_t>(value));
+			frame[i] = value;
+		}
+		std::copy(frame.begin(), frame.end(), previous);
+		state.lastSeq = seq;
+		state.valid = true;
+		return true;
+	}
+};
+
+#endif
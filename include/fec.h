@@ -0,0 +1,124 @@
+#if !defined FEC_H
+#define FEC_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <vector>
+#include <span>
+#include <initializer_list>
+#include <optional>
+
+#include <netaddress.h>
+
+// Арифметика в GF(2^8) (полином 0x11D) на таблицах логарифмов/умножения.
+uint8_t gfMul(uint8_t a, uint8_t b) noexcept;
+uint8_t gfInv(uint8_t a) noexcept;
+// dst[i] ^= coef * src[i]; SSSE3/AVX2 (pshufb по полубайтам), если доступны
+void gfMulAdd(uint8_t* dst, const uint8_t* src, uint8_t coef, size_t size) noexcept;
+
+// Коэффициент parity-символа j для data-символа i в блоке k + m.
+// При m == 1 — простой XOR, иначе матрица Коши (любые k строк из k + m обратимы).
+uint8_t fecCoefficient(uint8_t k, uint8_t m, uint8_t parityIndex, uint8_t dataIndex) noexcept;
+
+// Заголовок FEC (после байта FrameFlags), blockId big-endian.
+// index < k — кадр данных, index >= k — parity-кадр номер index - k.
+struct FecHeader
+{
+	uint16_t blockId;
+	uint8_t index;
+	uint8_t k;
+	uint8_t m;
+
+	static constexpr size_t SIZE = 5;
+
+	void write(uint8_t* out) const noexcept;
+	static FecHeader read(const uint8_t* in) noexcept;
+};
+
+// Символ блока: длина (2 байта, big-endian) + байты кадра, дополненные нулями до
+// размера самого длинного символа блока.
+constexpr size_t FEC_SYMBOL_OVERHEAD = 2;
+
+// Накопление parity-символов по мере отправки кадров блока (кадры не хранятся).
+class FecEncoder
+{
+	uint8_t k_;
+	uint8_t m_;
+	uint16_t blockId_ = 0;
+	uint8_t index_ = 0;
+	size_t symbolCapacity_;
+	size_t paritySize_ = 0;
+	std::vector<uint8_t> parity_;
+public:
+	FecEncoder(uint8_t k, uint8_t m, size_t maxFrameSize, uint16_t firstBlockId = 0);
+
+	uint8_t k() const { return k_; }
+	uint8_t m() const { return m_; }
+	size_t maxFrameSize() const { return symbolCapacity_ - FEC_SYMBOL_OVERHEAD; }
+
+	FecHeader dataHeader() const { return FecHeader{ blockId_, index_, k_, m_ }; }
+	FecHeader parityHeader(uint8_t j) const { return FecHeader{ blockId_, static_cast<uint8_t>(k_ + j), k_, m_ }; }
+
+	// Добавляет кадр, составленный из частей; true — блок заполнен и parity готовы
+	bool add(std::initializer_list<std::span<const uint8_t>> pieces);
+
+	size_t paritySize() const { return paritySize_; }
+	const uint8_t* parity(uint8_t j) const { return parity_.data() + j * symbolCapacity_; }
+
+	void nextBlock();
+};
+
+struct FecRecoveredFrame
+{
+	Endpoint peer;
+	const uint8_t* data; // действительно до следующего FecDecoder::add
+	size_t size;
+};
+
+// Хранение принятых символов и восстановление потерянных кадров данных.
+class FecDecoder
+{
+	struct Block
+	{
+		bool active = false;
+		Endpoint peer{ IP_ANY, 0 };
+		uint16_t blockId = 0;
+		uint8_t k = 0;
+		uint8_t m = 0;
+		uint8_t received = 0;
+		bool recovered = false;
+		uint64_t age = 0;
+		size_t paritySize = 0;
+		std::vector<uint8_t> have;     // k + m
+		std::vector<uint16_t> sizes;   // длины символов
+		std::vector<uint8_t> symbols;  // (k + m) * symbolCapacity
+	};
+
+	size_t symbolCapacity_;
+	uint8_t maxK_;
+	uint8_t maxM_;
+	uint64_t clock_ = 0;
+	size_t recoveredCount_ = 0;
+	std::vector<Block> blocks_;
+	std::vector<std::pair<Block*, uint8_t>> pending_;
+	size_t pendingRead_ = 0;
+	std::vector<uint8_t> matrix_;
+	std::vector<uint8_t> inverse_;
+
+	Block* findOrAllocate(const Endpoint& peer, const FecHeader& header);
+	void tryRecover(Block& block);
+public:
+	FecDecoder(size_t slots, uint8_t maxK, uint8_t maxM, size_t maxFrameSize);
+
+	// Сохраняет кадр (данные или parity). Возвращает false только для дубликата кадра
+	// данных, который уже был принят или восстановлен; кадр, который нельзя сохранить
+	// (блок больше maxK/maxM, слишком длинный кадр), просто не участвует в восстановлении.
+	bool add(const Endpoint& peer, const FecHeader& header, std::initializer_list<std::span<const uint8_t>> pieces);
+
+	// Кадры данных, восстановленные после последнего add
+	std::optional<FecRecoveredFrame> popRecovered();
+
+	size_t recoveredCount() const { return recoveredCount_; }
+};
+
+#endif
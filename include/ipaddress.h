@@ -4,55 +4,16 @@
 #include <inttypes.h>
 #include <string>
 #include <sstream>
+#include <string_view>
 #include <optional>
 #include <cassert>
+#include <stdexcept>
 #include <array>
 #include <bit>
 #include <type_traits>
-#include <format>
 
+#include <byteorder.h>
 
-static_assert(__cplusplus >= 202002L,
-"This library does not support c++ older then c++20!"
-);
-
-static_assert
-(
-	std::endian::native == std::endian::little ||
-	std::endian::native == std::endian::big,
-	"This library does not support mixed-endian (PDP-endian) architectures!"
-);
-
-
-template<typename T>
-constexpr T reverseByteOrder(T val)
-{
-	static_assert(std::is_trivially_copyable<T>(), "template<typename T> static constexpr T reverseByteOrder(T) T shoud be trivially copyable (POD-like)");
-	std::array<uint8_t, sizeof(T)> res = std::bit_cast<std::array<uint8_t, sizeof(T)>>(val);
-	for(size_t i = 0; i < sizeof(T)/2; ++i)
-	{
-		std::swap(res[i], res[sizeof(T)-1-i]);
-	}
-	return std::bit_cast<T>(res);
-}
-
-template<typename T>
-constexpr T hton(T val)
-{
-	static_assert(std::is_trivially_copyable<T>(), "template<typename T> static constexpr T hton(T) T shoud be trivially copyable (POD-like)");
-	if(std::endian::native == std::endian::big)
-		return val;
-	return reverseByteOrder(val);
-}
-
-template<typename T>
-constexpr T ntoh(T val)
-{
-	static_assert(std::is_trivially_copyable<T>(), "template<typename T> static constexpr T ntoh(T) T shoud be trivially copyable (POD-like)");
-	if(std::endian::native == std::endian::big)
-		return val;
-	return reverseByteOrder(val);
-}
 
 class IPAddress
 {
@@ -66,7 +27,38 @@ class IPAddress
 	octets_(ip)
 	{}
 
-	
+	static std::optional<IPAddress> fromStringFast(std::string_view str) noexcept;
+
+	static constexpr std::optional<IPAddress> fromStringScalar(std::string_view str) noexcept
+	{
+		std::array<uint8_t, 4> octets{};
+		size_t pos = 0;
+		for(int i = 0; i < 4; ++i)
+		{
+			size_t end = str.find('.', pos);
+			if(i < 3 && end == std::string_view::npos)
+				return std::nullopt;
+			if(i == 3 && end != std::string_view::npos)
+				return std::nullopt;
+
+			std::string_view subStr = i == 3 ? str.substr(pos) : str.substr(pos, end - pos);
+			if(subStr.empty() || subStr.size() > 3)
+				return std::nullopt;
+			uint16_t val = 0;
+			for(char c: subStr)
+			{
+				if(c < '0' || c > '9')
+					return std::nullopt;
+				val = val * 10 + (c - '0');
+			}
+			if(val > 255)
+				return std::nullopt;
+			octets[i] = static_cast<uint8_t>(val);
+			pos = end + 1;
+		}
+		return IPAddress(octets);
+	}
+
 
 
 public:
@@ -89,11 +81,28 @@ public:
 		return IPAddress(ip);
 	}
 
-	static std::optional<IPAddress> fromString(std::string_view str);
-	static std::optional<IPAddress> fromString(const char* str);
+	// Работает и при компиляции: constexpr IPAddress ip = IPAddress::fromString("10.0.0.1").value();
+	static constexpr std::optional<IPAddress> fromString(std::string_view str) noexcept
+	{
+		if(std::is_constant_evaluated())
+			return fromStringScalar(str);
+		return fromStringFast(str);
+	}
+	static constexpr std::optional<IPAddress> fromString(const char* str) noexcept
+	{
+		return str ? fromString(std::string_view(str)) : std::nullopt;
+	}
+
+	static constexpr size_t MAX_STRING_SIZE = 15; // "255.255.255.255"
+
+	// Пишет точечную запись без завершающего нуля, возвращает указатель за последним символом.
+	// В buffer должно быть не меньше MAX_STRING_SIZE + 1 байт. Без выделения памяти.
+	char* toChars(char* buffer) const noexcept;
+
 	std::string toString() const
 	{
-		return std::format("{}.{}.{}.{}", first(), second(), third(), fourth());
+		char buffer[MAX_STRING_SIZE + 1];
+		return std::string(buffer, toChars(buffer));
 	}
 
 	constexpr uint32_t toHost() const noexcept
@@ -139,6 +148,8 @@ public:
 	constexpr uint8_t& third() noexcept  { return octets_[2]; }
 	constexpr uint8_t& fourth() noexcept { return octets_[3]; }
 
+	constexpr bool isMulticast() const noexcept { return (octets_[0] & 0xF0) == 0xE0; } // 224.0.0.0/4
+
 	constexpr bool operator==(const IPAddress& other) const noexcept { return octets_ == other.octets_; }
 	constexpr bool operator!=(const IPAddress& other) const noexcept { return !(*this == other); }
 
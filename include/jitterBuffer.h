@@ -0,0 +1,104 @@
+#if !defined JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <vector>
+#include <optional>
+#include <chrono>
+
+#include <udpsocket.h>
+
+struct JitterStats
+{
+	uint64_t received = 0;
+	uint64_t played = 0;
+	uint64_t late = 0;        // пришли после того, как их очередь прошла
+	uint64_t lost = 0;        // пропущены при воспроизведении (не пришли вовремя)
+	uint64_t duplicates = 0;
+	uint64_t overflow = 0;    // вытеснены: кадр слишком далеко впереди для окна
+};
+
+struct JitterFrame
+{
+	uint32_t sequence;
+	size_t size;
+	std::chrono::steady_clock::duration mediaTime;
+};
+
+// Буфер сглаживания задержки: кадры упорядочиваются по номеру и выдаются в момент
+// mediaTime + минимальное время в пути + задержка воспроизведения. Задержка
+// подстраивается под измеренный джиттер (оценка RFC 3550) в заданных пределах.
+// Вся память выделяется в конструкторе: кольцо из capacity слотов по номеру кадра.
+class JitterBuffer
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+private:
+	struct Slot
+	{
+		bool filled = false;
+		uint32_t sequence = 0;
+		Clock::duration mediaTime{ 0 };
+		size_t size = 0;
+	};
+
+	std::vector<Slot> slots_;
+	std::vector<uint8_t> data_;
+	size_t mask_;
+	size_t maxFrameSize_;
+
+	Clock::duration minDelay_;
+	Clock::duration maxDelay_;
+	double jitterFactor_ = 4.0;
+	Clock::duration delay_;
+
+	bool started_ = false;
+	uint32_t nextSequence_ = 0;   // следующий к выдаче
+	uint32_t endSequence_ = 0;    // за последним принятым
+	bool haveTransit_ = false;
+	int64_t baseTransit_ = 0;     // минимальное время в пути (с точностью до смещения часов), нс
+	int64_t lastTransit_ = 0;
+	double jitter_ = 0;           // нс
+	JitterStats stats_;
+
+	Slot& slotOf(uint32_t sequence) { return slots_[sequence & mask_]; }
+	const Slot& slotOf(uint32_t sequence) const { return slots_[sequence & mask_]; }
+	Clock::time_point playoutTime(const Slot& slot) const;
+	void updateJitter(Clock::duration mediaTime, Clock::time_point arrival);
+	void skip(); // nextSequence_ пропущен
+	void resetWindow(uint32_t next, uint32_t skipped); // окно начинается заново с next
+
+public:
+	// capacity округляется вверх до степени двойки
+	JitterBuffer(size_t capacity = 64, size_t maxFrameSize = 1500,
+		Clock::duration minDelay = std::chrono::milliseconds(20),
+		Clock::duration maxDelay = std::chrono::milliseconds(500));
+
+	// mediaTime — метка времени отправителя (любая эпоха, одинаковая для всех кадров).
+	// false, если кадр опоздал, повторный или длиннее maxFrameSize. Номер, откатившийся
+	// дальше чем на capacity (перезапуск отправителя), начинает окно заново.
+	bool push(uint32_t sequence, Clock::duration mediaTime, const uint8_t* data, size_t size, Clock::time_point arrival = Clock::now());
+	// Номер — из ReceiveInfo::sequence (нужен setSequencing у отправителя). Получатель
+	// должен включить setSequencing(true, false): с dropStale (по умолчанию) переставленные
+	// кадры отбрасываются до буфера, и упорядочивать ему нечего.
+	bool push(const ReceiveInfo& info, Clock::duration mediaTime, const uint8_t* data, Clock::time_point arrival = Clock::now());
+
+	// Следующий кадр, если подошло его время; не пришедшие вовремя кадры пропускаются
+	std::optional<JitterFrame> pop(uint8_t* buffer, size_t maxSize, Clock::time_point now = Clock::now());
+	// Когда следующий принятый кадр будет готов к выдаче
+	std::optional<Clock::time_point> nextPlayout() const;
+
+	void setDelayLimits(Clock::duration minDelay, Clock::duration maxDelay);
+	// Задержка = jitterFactor * джиттер, но в пределах [minDelay, maxDelay]
+	void setJitterFactor(double factor) { jitterFactor_ = factor; }
+
+	Clock::duration delay() const { return delay_; }
+	Clock::duration jitter() const { return std::chrono::nanoseconds(static_cast<int64_t>(jitter_)); }
+	const JitterStats& stats() const { return stats_; }
+	size_t capacity() const { return slots_.size(); }
+	void reset(); // статистика сохраняется
+};
+
+#endif
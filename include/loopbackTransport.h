@@ -0,0 +1,87 @@
+#if !defined LOOPBACK_TRANSPORT_H
+#define LOOPBACK_TRANSPORT_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include <udpsocket.h>
+#include <netaddress.h>
+
+class LoopbackTransport;
+
+// Сеть в памяти процесса: LoopbackTransport регистрируются в ней по адресу и порту
+// и обмениваются датаграммами без системных вызовов. Сеть должна жить дольше транспортов.
+class LoopbackNetwork
+{
+	mutable std::shared_mutex mutex_;
+	std::unordered_map<Endpoint, LoopbackTransport*> nodes_;
+	uint16_t nextPort_ = 49152; // свободные порты выдаются из динамического диапазона
+
+	friend class LoopbackTransport;
+
+	Endpoint attach(LoopbackTransport* node, const NetAddress& ip, uint16_t port);
+	void detach(const Endpoint& local);
+	// Вызывать под mutex_
+	LoopbackTransport* find(const NetAddress& ip, uint16_t port) const;
+
+public:
+	LoopbackNetwork() = default;
+	LoopbackNetwork(const LoopbackNetwork&) = delete;
+	LoopbackNetwork& operator=(const LoopbackNetwork&) = delete;
+
+	size_t size() const;
+};
+
+// Транспорт поверх LoopbackNetwork. Входящие датаграммы лежат в кольце фиксированного
+// размера без блокировок: отправлять могут любые потоки, принимать — один поток.
+// Когда кольцо заполнено, новые датаграммы теряются (как при переполнении буфера сокета).
+// Широковещательный и multicast адрес доставляет датаграмму всем узлам на том же порту, кроме себя.
+class LoopbackTransport : public Transport
+{
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		Endpoint source;
+		size_t size = 0;
+		std::vector<uint8_t> data; // ёмкость переиспользуется
+	};
+
+	LoopbackNetwork& network_;
+	Endpoint local_;
+	Endpoint source_; // адрес отправителя в чужих ReceiveInfo: 0.0.0.0 заменяется на 127.0.0.1
+	std::unique_ptr<Slot[]> slots_;
+	size_t mask_;
+	alignas(64) std::atomic<size_t> enqueuePos_{ 0 };
+	alignas(64) size_t dequeuePos_ = 0;
+	std::atomic<uint64_t> dropped_{ 0 };
+
+	bool push(const Endpoint& source, const DatagramView& datagram);
+	void deliver(const DatagramView& datagram, const NetAddress& ip, uint16_t port);
+
+public:
+	// port host-endian, 0 — свободный порт; capacity округляется вверх до степени двойки.
+	// Если адрес уже занят — std::runtime_error.
+	LoopbackTransport(LoopbackNetwork& network, NetAddress ip = IPAddress(127, 0, 0, 1), uint16_t port = 0, size_t capacity = 1024);
+	~LoopbackTransport() override;
+
+	LoopbackTransport(const LoopbackTransport&) = delete;
+	LoopbackTransport& operator=(const LoopbackTransport&) = delete;
+
+	std::variant<size_t, UDPError> send_batch(const DatagramView* datagrams, size_t count, IPAddress ip) override;
+	std::variant<size_t, UDPError> send_batch(const DatagramView* datagrams, const Endpoint* destinations, size_t count) override;
+	std::variant<ReceiveInfo, UDPError> recieve(uint8_t* buf, size_t size) override;
+
+	uint16_t getBindPort() override { return local_.port; }
+	uint32_t getBindInterface() override;
+
+	const Endpoint& localEndpoint() const { return local_; }
+	// Датаграммы, потерянные из-за заполненного кольца этого узла
+	uint64_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -0,0 +1,72 @@
+#if !defined MAGIC_TAG_H
+#define MAGIC_TAG_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <cstring>
+#include <bit>
+#include <string>
+#include <type_traits>
+
+// Magic-метка фиксированной ширины (4 или 8 байт). Байты на проводе те же, что у
+// magic-строки из тех же символов, но сравнение — одна целочисленная загрузка.
+// Структурный тип: можно передавать как параметр шаблона (template <MagicTag Tag>).
+template <size_t N>
+	requires (N == 4 || N == 8)
+struct MagicTag
+{
+	using Word = std::conditional_t<N == 4, uint32_t, uint64_t>;
+	static constexpr size_t SIZE = N;
+
+	Word value; // байты метки в порядке памяти
+
+	consteval MagicTag(const char (&text)[N + 1]) : value(0)
+	{
+		for(size_t i = 0; i < N; ++i)
+		{
+			size_t shift = std::endian::native == std::endian::little ? i * 8 : (N - 1 - i) * 8;
+			value |= static_cast<Word>(static_cast<uint8_t>(text[i])) << shift;
+		}
+	}
+
+	static MagicTag fromBytes(const uint8_t* data) noexcept
+	{
+		MagicTag tag;
+		memcpy(&tag.value, data, N);
+		return tag;
+	}
+
+	bool matches(const uint8_t* data) const noexcept
+	{
+		Word word;
+		memcpy(&word, data, N);
+		return word == value;
+	}
+
+	void write(uint8_t* out) const noexcept
+	{
+		memcpy(out, &value, N);
+	}
+
+	std::string toString() const
+	{
+		return std::string(reinterpret_cast<const char*>(&value), N);
+	}
+
+	constexpr bool operator==(const MagicTag&) const = default;
+
+private:
+	constexpr MagicTag() : value(0) {}
+};
+
+template <size_t L>
+MagicTag(const char (&)[L]) -> MagicTag<L - 1>;
+
+// Проверка метки, известной на этапе компиляции: сравнение с константой
+template <MagicTag Tag>
+inline bool matchesTag(const uint8_t* data, size_t size) noexcept
+{
+	return size >= Tag.SIZE && Tag.matches(data);
+}
+
+#endif
@@ -7,17 +7,61 @@
 #include <type_traits>
 #include <cstring>
 #include <stdexcept>
+#include <span>
+#include <ranges>
+#include <cstdint>
 
+#include <byteorder.h>
+
+template <typename T>
+struct MessageSchema; // специализируется через Schema<...> из messageSchema.h
+
+// Заголовок (размер и позиция чтения) лежит перед данными: короткое сообщение
+// и его заголовок читаются из одной кэш-линии. Копирование и перемещение
+// переносят только занятые байты, а не всю ёмкость N.
 template <size_t N>
 class Message
 {
+	using SizeType = std::conditional_t<(N <= UINT32_MAX), uint32_t, size_t>;
+
+	SizeType size_;
+	SizeType readPtr_;
 	uint8_t array_[N];
-	size_t size_;
-	size_t readPtr_;
 public:
 	Message() : size_(0), readPtr_(0) 
 	{}
 
+	Message(const Message& other) : size_(other.size_), readPtr_(other.readPtr_)
+	{
+		memcpy(array_, other.array_, size_);
+	}
+
+	Message& operator=(const Message& other)
+	{
+		if(this != &other)
+		{
+			memcpy(array_, other.array_, other.size_);
+			size_ = other.size_;
+			readPtr_ = other.readPtr_;
+		}
+		return *this;
+	}
+
+	// Данные встроены в объект, поэтому перемещение — то же копирование занятых байт;
+	// исходное сообщение остаётся пустым
+	Message(Message&& other) noexcept : Message(static_cast<const Message&>(other))
+	{
+		other.clear();
+	}
+
+	Message& operator=(Message&& other) noexcept
+	{
+		*this = static_cast<const Message&>(other);
+		if(this != &other)
+			other.clear();
+		return *this;
+	}
+
 	size_t getSize() const
 	{
 		return size_;
@@ -35,7 +79,7 @@ public:
 
 	size_t capacity() const
 	{
-		return getCapacity;
+		return getCapacity();
 	}
 
 	size_t getSpace() const
@@ -124,6 +168,48 @@ public:
 		return getSpace();
 	}
 
+	template <typename T>
+	size_t pushArray(const T* data, size_t count) //Записывает массив в сетевом порядке байт, возвращает оставшееся место
+	{
+		if(count > getSpace() / sizeof(T))
+		{
+			throw std::length_error("Message::pushArray<T>(const T*, size_t) the array size must be less than the remaining space");
+		}
+		static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "T must be arithmetic or enum for byte order conversion.");
+		htonBulk(getEnd(), data, count, sizeof(T));
+		size_ += count * sizeof(T);
+		return getSpace();
+	}
+
+	// Любой непрерывный диапазон: std::vector<T>, std::array<T, M>, std::span<T> и т. п.
+	template <std::ranges::contiguous_range R> requires std::ranges::sized_range<R>
+	size_t pushArray(const R& data)
+	{
+		return pushArray(std::ranges::data(data), std::ranges::size(data));
+	}
+
+	template <typename T>
+	size_t pushVarint(T value) // LEB128, знаковые типы через zigzag; возвращает оставшееся место
+	{
+		static_assert(std::is_integral_v<T>, "T must be integral for varint encoding.");
+		using U = std::make_unsigned_t<T>;
+		U v;
+		if constexpr (std::is_signed_v<T>)
+			v = (static_cast<U>(value) << 1) ^ static_cast<U>(value >> (sizeof(T) * 8 - 1));
+		else
+			v = value;
+
+		uint8_t buf[(sizeof(T) * 8 + 6) / 7];
+		size_t len = 0;
+		while(v >= 0x80)
+		{
+			buf[len++] = static_cast<uint8_t>(v) | 0x80;
+			v >>= 7;
+		}
+		buf[len++] = static_cast<uint8_t>(v);
+		return push(buf, len);
+	}
+
 	size_t pop(uint8_t* data, size_t size)
 	{
 		if(size > size_)
@@ -175,6 +261,19 @@ public:
 		return data;
 	}
 
+	template <typename T>
+	size_t pushPacked(const T& data) //Возвращает оставшееся место
+	{
+		constexpr size_t wireSize = MessageSchema<T>::wireSize;
+		if(wireSize > getSpace())
+		{
+			throw std::length_error("Message::pushPacked<T>(const T&) the packed size must be less than the remaining space");
+		}
+		MessageSchema<T>::encode(data, getEnd());
+		size_ += wireSize;
+		return getSpace();
+	}
+
 	void clear()
 	{
 		size_ = 0;
@@ -208,6 +307,65 @@ public:
 		return data;
 	}
 	
+	template <typename T>
+	T readPacked()
+	{
+		constexpr size_t wireSize = MessageSchema<T>::wireSize;
+		if(readPtr_ + wireSize > size_)
+		{
+			throw std::out_of_range("Message::readPacked<T>() attempt to access memory not owned by Message");
+		}
+		T data{};
+		MessageSchema<T>::decode(data, array_ + readPtr_);
+		readPtr_ += wireSize;
+		return data;
+	}
+	
+	template <typename T>
+	void readArray(T* data, size_t count)
+	{
+		if(count > (size_ - readPtr_) / sizeof(T))
+		{
+			throw std::out_of_range("Message::readArray<T>(T*, size_t) attempt to access memory not owned by Message");
+		}
+		static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "T must be arithmetic or enum for byte order conversion.");
+		ntohBulk(data, array_ + readPtr_, count, sizeof(T));
+		readPtr_ += count * sizeof(T);
+	}
+
+	template <std::ranges::contiguous_range R> requires std::ranges::sized_range<R>
+	void readArray(R&& data)
+	{
+		readArray(std::ranges::data(data), std::ranges::size(data));
+	}
+	
+	template <typename T>
+	T readVarint()
+	{
+		static_assert(std::is_integral_v<T>, "T must be integral for varint decoding.");
+		using U = std::make_unsigned_t<T>;
+		constexpr size_t maxLen = (sizeof(T) * 8 + 6) / 7;
+		U v = 0;
+		size_t len = 0;
+		while(true)
+		{
+			if(readPtr_ + len >= size_ || len >= maxLen)
+			{
+				throw std::out_of_range("Message::readVarint<T>() truncated or overlong varint");
+			}
+			uint8_t byte = array_[readPtr_ + len];
+			v |= static_cast<U>(byte & 0x7F) << (7 * len);
+			++len;
+			if(!(byte & 0x80))
+				break;
+		}
+		readPtr_ += len;
+		if constexpr (std::is_signed_v<T>)
+			return static_cast<T>((v >> 1) ^ (~(v & 1) + 1));
+		else
+			return v;
+	}
+	
 	char* readString()
 	{
 		if(readPtr_ >= size_)
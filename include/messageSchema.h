@@ -0,0 +1,143 @@
+#if !defined MESSAGE_SCHEMA_H
+#define MESSAGE_SCHEMA_H
+
+#include <cstddef>
+#include <inttypes.h>
+#include <cstring>
+#include <array>
+#include <type_traits>
+
+#include <message.h>
+#include <byteorder.h>
+
+// Упакованная (без padding) сериализация структур с сетевым порядком байт.
+// Схема объявляется списком указателей на поля:
+//
+//	template<> struct MessageSchema<exempleStruct> : Schema<&exempleStruct::a, &exempleStruct::b> {};
+//
+// после чего структуру можно передавать через Message::pushPacked / Message::readPacked.
+
+template<typename T, typename = void>
+struct SchemaField
+{
+	static_assert(!sizeof(T*), "SchemaField<T> T must be arithmetic, enum, std::array of them or a type with MessageSchema<T>");
+};
+
+template<typename T>
+struct SchemaField<T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>>
+{
+	static constexpr size_t wireSize = sizeof(T);
+
+	static void encode(const T& val, uint8_t* out) noexcept
+	{
+		T net = hton(val);
+		memcpy(out, &net, sizeof(T));
+	}
+
+	static void decode(T& val, const uint8_t* in) noexcept
+	{
+		memcpy(&val, in, sizeof(T));
+		val = ntoh(val);
+	}
+};
+
+template<typename T, size_t K>
+struct SchemaField<std::array<T, K>>
+{
+	static constexpr size_t wireSize = SchemaField<T>::wireSize * K;
+
+	static void encode(const std::array<T, K>& val, uint8_t* out) noexcept
+	{
+		if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+			htonBulk(out, val.data(), K, sizeof(T));
+		else
+			for(size_t i = 0; i < K; ++i)
+				SchemaField<T>::encode(val[i], out + i * SchemaField<T>::wireSize);
+	}
+
+	static void decode(std::array<T, K>& val, const uint8_t* in) noexcept
+	{
+		if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+			ntohBulk(val.data(), in, K, sizeof(T));
+		else
+			for(size_t i = 0; i < K; ++i)
+				SchemaField<T>::decode(val[i], in + i * SchemaField<T>::wireSize);
+	}
+};
+
+template<typename T>
+struct SchemaField<T, std::void_t<decltype(MessageSchema<T>::wireSize)>>
+{
+	static constexpr size_t wireSize = MessageSchema<T>::wireSize;
+
+	static void encode(const T& val, uint8_t* out) noexcept
+	{
+		MessageSchema<T>::encode(val, out);
+	}
+
+	static void decode(T& val, const uint8_t* in) noexcept
+	{
+		MessageSchema<T>::decode(val, in);
+	}
+};
+
+template<auto Member>
+struct SchemaMember;
+
+template<typename C, typename F, F C::*Member>
+struct SchemaMember<Member>
+{
+	using Class = C;
+	using Field = std::remove_cv_t<F>;
+	static constexpr size_t wireSize = SchemaField<Field>::wireSize;
+};
+
+template<auto First, auto... Members>
+struct Schema
+{
+	using Class = typename SchemaMember<First>::Class;
+
+	static_assert((std::is_same_v<Class, typename SchemaMember<Members>::Class> && ...),
+		"Schema<Members...> all members must belong to the same struct");
+	static_assert(std::is_default_constructible_v<Class>, "Schema<Members...> struct must be default constructible");
+
+	static constexpr size_t wireSize = (SchemaMember<First>::wireSize + ... + SchemaMember<Members>::wireSize);
+
+	// out должен вмещать wireSize байт, проверка размера — на стороне вызывающего
+	static void encode(const Class& obj, uint8_t* out) noexcept
+	{
+		encodeFields<First, Members...>(obj, out);
+	}
+
+	// in должен содержать wireSize байт, проверка размера — на стороне вызывающего
+	static void decode(Class& obj, const uint8_t* in) noexcept
+	{
+		decodeFields<First, Members...>(obj, in);
+	}
+
+	static Class decode(const uint8_t* in) noexcept
+	{
+		Class obj{};
+		decode(obj, in);
+		return obj;
+	}
+
+private:
+	template<auto M, auto... Rest>
+	static void encodeFields(const Class& obj, uint8_t* out) noexcept
+	{
+		SchemaField<typename SchemaMember<M>::Field>::encode(obj.*M, out);
+		if constexpr (sizeof...(Rest) > 0)
+			encodeFields<Rest...>(obj, out + SchemaMember<M>::wireSize);
+	}
+
+	template<auto M, auto... Rest>
+	static void decodeFields(Class& obj, const uint8_t* in) noexcept
+	{
+		SchemaField<typename SchemaMember<M>::Field>::decode(obj.*M, in);
+		if constexpr (sizeof...(Rest) > 0)
+			decodeFields<Rest...>(obj, in + SchemaMember<M>::wireSize);
+	}
+};
+
+#endif
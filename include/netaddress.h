@@ -0,0 +1,122 @@
+#if !defined NET_ADDRESS_H
+#define NET_ADDRESS_H
+
+#include <inttypes.h>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <array>
+#include <ostream>
+#include <cstring>
+
+#include <ipaddress.h>
+
+// Адрес IPv4 или IPv6, 16 байт в сетевом порядке. IPv4 хранится как
+// IPv4-mapped (::ffff:a.b.c.d), поэтому IPAddress неявно приводится к NetAddress
+// и оба вида адресов сравниваются и хешируются одинаково.
+class NetAddress
+{
+	std::array<uint8_t, 16> bytes_{};
+
+public:
+	constexpr NetAddress() noexcept = default; // ::
+
+	constexpr NetAddress(IPAddress ip) noexcept :
+	bytes_{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, ip[0], ip[1], ip[2], ip[3] }
+	{}
+
+	constexpr explicit NetAddress(const std::array<uint8_t, 16>& bytes) noexcept :
+	bytes_(bytes)
+	{}
+
+	// Из восьми 16-битных групп, как в записи a:b:c:d:e:f:g:h
+	static constexpr NetAddress fromGroups(uint16_t g0, uint16_t g1, uint16_t g2, uint16_t g3,
+		uint16_t g4, uint16_t g5, uint16_t g6, uint16_t g7) noexcept
+	{
+		const uint16_t groups[8] = { g0, g1, g2, g3, g4, g5, g6, g7 };
+		std::array<uint8_t, 16> bytes{};
+		for(size_t i = 0; i < 8; ++i)
+		{
+			bytes[i * 2] = static_cast<uint8_t>(groups[i] >> 8);
+			bytes[i * 2 + 1] = static_cast<uint8_t>(groups[i]);
+		}
+		return NetAddress(bytes);
+	}
+
+	static std::optional<NetAddress> fromString(std::string_view str);
+	static std::optional<NetAddress> fromString(const char* str);
+	std::string toString() const; // IPv4 — точечная запись, IPv6 — сокращённая (RFC 5952)
+
+	constexpr bool isV4() const noexcept
+	{
+		for(size_t i = 0; i < 10; ++i)
+			if(bytes_[i] != 0)
+				return false;
+		return bytes_[10] == 0xFF && bytes_[11] == 0xFF;
+	}
+
+	constexpr std::optional<IPAddress> toV4() const noexcept
+	{
+		if(!isV4())
+			return std::nullopt;
+		return IPAddress(bytes_[12], bytes_[13], bytes_[14], bytes_[15]);
+	}
+
+	constexpr bool isUnspecified() const noexcept
+	{
+		for(uint8_t byte : bytes_)
+			if(byte != 0)
+				return false;
+		return true;
+	}
+
+	constexpr const std::array<uint8_t, 16>& bytes() const noexcept { return bytes_; }
+	constexpr uint8_t operator[](size_t index) const noexcept { return bytes_[index]; }
+
+	constexpr bool operator==(const NetAddress& other) const noexcept = default;
+
+	friend std::ostream& operator<<(std::ostream& stream, const NetAddress& address);
+};
+
+inline constexpr NetAddress NET_ANY6{};
+inline constexpr NetAddress NET_LOCALHOST6 = NetAddress::fromGroups(0, 0, 0, 0, 0, 0, 0, 1);
+
+
+// Адрес узла: IP (v4 или v6) и порт (host-endian)
+struct Endpoint
+{
+	NetAddress ip;
+	uint16_t port;
+
+	constexpr bool operator==(const Endpoint& other) const noexcept { return ip == other.ip && port == other.port; }
+	constexpr bool operator!=(const Endpoint& other) const noexcept { return !(*this == other); }
+};
+
+
+namespace std
+{
+	template<>
+	struct hash<NetAddress>
+	{
+		size_t operator()(const NetAddress& address) const noexcept
+		{
+			uint64_t lo;
+			uint64_t hi;
+			memcpy(&lo, address.bytes().data(), 8);
+			memcpy(&hi, address.bytes().data() + 8, 8);
+			uint64_t h = (lo ^ (hi * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+			return static_cast<size_t>(h ^ (h >> 31));
+		}
+	};
+
+	template<>
+	struct hash<Endpoint>
+	{
+		size_t operator()(const Endpoint& endpoint) const noexcept
+		{
+			return std::hash<NetAddress>{}(endpoint.ip) ^ static_cast<size_t>((endpoint.port + 1ull) * 0x9E3779B97F4A7C15ull);
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,98 @@
+#if !defined NETEM_TRANSPORT_H
+#define NETEM_TRANSPORT_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <udpsocket.h>
+
+// Параметры искажений, как у tc netem. Вероятности — от 0 до 1.
+struct NetemConfig
+{
+	double loss = 0;
+	double duplicate = 0;
+	double reorder = 0; // доля датаграмм, уходящих без задержки (обгоняют задержанные)
+	std::chrono::microseconds delay{ 0 };
+	std::chrono::microseconds jitter{ 0 }; // задержка равномерно в delay ± jitter
+	uint64_t rate = 0; // байт/с, 0 — без ограничения полосы
+	size_t limit = 1000; // датаграмм в очереди задержки, лишние теряются
+	uint64_t seed = 1; // одинаковый seed — одинаковая последовательность потерь и задержек
+};
+
+struct NetemStats
+{
+	uint64_t sent = 0;       // датаграмм передано в send_batch
+	uint64_t lost = 0;
+	uint64_t duplicated = 0;
+	uint64_t reordered = 0;
+	uint64_t overflow = 0;   // не поместились в очередь (limit)
+	uint64_t delivered = 0;  // передано внутреннему транспорту
+	uint64_t failed = 0;     // из очереди, но не приняты внутренним транспортом (ошибка, неполная отправка)
+};
+
+// Эмулятор сети поверх другого транспорта (UDPSocket, LoopbackTransport): искажает
+// исходящие датаграммы, как netem на исходящем интерфейсе. Без задержки и полосы
+// датаграммы проходят сразу без копирования; иначе копируются в очередь и уходят,
+// когда подошло время, — при следующем send_batch, recieve или poll().
+// Для искажений в обе стороны эмулятор ставится на обоих узлах. Не потокобезопасен.
+class NetemTransport : public Transport
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+private:
+	struct Pending
+	{
+		Clock::time_point due;
+		uint64_t order; // при равном времени — в порядке отправки
+		Endpoint destination;
+		std::vector<uint8_t> data;
+	};
+
+	Transport& inner_;
+	NetemConfig config_;
+	std::mt19937_64 random_;
+	NetemStats stats_;
+	std::vector<Pending> queue_; // куча по due
+	std::vector<Pending> ready_;
+	std::vector<std::vector<uint8_t>> spare_;
+	std::vector<DatagramView> views_;
+	std::vector<Endpoint> destinations_;
+	Clock::time_point linkFree_{};
+	uint64_t order_ = 0;
+
+	double uniform();
+	bool chance(double probability);
+	bool immediate() const;
+	void enqueue(const DatagramView& datagram, const Endpoint& destination, Clock::time_point now);
+	std::variant<size_t, UDPError> send(const DatagramView* datagrams, const Endpoint* destinations, size_t count, IPAddress ip);
+
+public:
+	// Внутренний транспорт должен жить дольше эмулятора
+	explicit NetemTransport(Transport& inner, NetemConfig config = {});
+
+	// Неверные параметры — std::invalid_argument. Seed перезапускает генератор.
+	void setConfig(const NetemConfig& config);
+	const NetemConfig& config() const { return config_; }
+
+	// Отдаёт внутреннему транспорту датаграммы, чьё время подошло; возвращает их число
+	size_t poll(Clock::time_point now = Clock::now());
+	size_t pending() const { return queue_.size(); }
+	// Время, когда уйдёт следующая задержанная датаграмма
+	std::optional<Clock::time_point> nextDue() const;
+
+	const NetemStats& stats() const { return stats_; }
+	void resetStats() { stats_ = NetemStats{}; }
+
+	std::variant<size_t, UDPError> send_batch(const DatagramView* datagrams, size_t count, IPAddress ip) override;
+	std::variant<size_t, UDPError> send_batch(const DatagramView* datagrams, const Endpoint* destinations, size_t count) override;
+	std::variant<ReceiveInfo, UDPError> recieve(uint8_t* buf, size_t size) override;
+
+	uint16_t getBindPort() override { return inner_.getBindPort(); }
+	uint32_t getBindInterface() override { return inner_.getBindInterface(); }
+};
+
+#endif
@@ -0,0 +1,32 @@
+#if !defined PACER_H
+#define PACER_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <chrono>
+
+// Токен-бакет: в среднем rate байт/с, подряд без пауз — не больше burst байт.
+// Токены могут уходить в минус: reserve сразу списывает размер и возвращает,
+// сколько нужно подождать перед отправкой, поэтому отправки идут равномерно.
+class TokenBucket
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+private:
+	double rate_;     // байт в наносекунду
+	double burst_;
+	double tokens_;
+	Clock::time_point last_;
+
+public:
+	TokenBucket(uint64_t bytesPerSecond, size_t burstBytes, Clock::time_point now = Clock::now());
+
+	// Списывает bytes; возвращает время ожидания до отправки (ноль — можно сразу)
+	Clock::duration reserve(size_t bytes, Clock::time_point now = Clock::now());
+
+	uint64_t rate() const { return static_cast<uint64_t>(rate_ * 1e9); }
+	size_t burst() const { return static_cast<size_t>(burst_); }
+};
+
+#endif
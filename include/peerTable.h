@@ -0,0 +1,115 @@
+#if !defined PEER_TABLE_H
+#define PEER_TABLE_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <vector>
+#include <chrono>
+#include <memory>
+
+#include <netaddress.h>
+#include <clockSync.h>
+#include <fec.h>
+
+struct SequenceStats
+{
+	uint64_t received = 0;    // принятые сообщения
+	uint64_t gaps = 0;        // пропущенные номера (в том числе пришедшие позже)
+	uint64_t reordered = 0;   // сообщения старше последнего принятого
+	uint64_t duplicates = 0;
+	uint64_t dropped = 0;     // отброшенные как устаревшие или повторные
+	uint64_t restarts = 0;    // откаты номера дальше окна перестановок: отправитель перезапущен
+
+	SequenceStats& operator+=(const SequenceStats& other)
+	{
+		received += other.received;
+		gaps += other.gaps;
+		reordered += other.reordered;
+		duplicates += other.duplicates;
+		dropped += other.dropped;
+		restarts += other.restarts;
+		return *this;
+	}
+};
+
+struct PeerSession
+{
+	Endpoint endpoint{ IP_ANY, 0 };
+	std::chrono::steady_clock::time_point lastSeen;
+
+	uint32_t lastSequence = 0;
+	bool sequenceValid = false;
+	SequenceStats sequence;
+
+	uint64_t packetsReceived = 0;
+	uint64_t bytesReceived = 0;
+	uint64_t packetsSent = 0;   // через sendDataTo/sendDataToAll
+	uint64_t bytesSent = 0;
+
+	// Поток отправки узлу: свои номера сообщений и FEC-блоки, чтобы узел не видел
+	// пропусков в нумерации и parity не покрывали кадры, ушедшие другим узлам
+	uint32_t nextSequence = 0;
+	bool sendStreamValid = false;
+	std::unique_ptr<FecEncoder> fec;
+
+	ClockEstimator clock;       // заполняется при setClockSync
+
+	bool alive = false;         // при setHeartbeat: пакеты приходят чаще порога пропусков
+	uint32_t livenessTimer = UINT32_MAX;
+};
+
+// Таблица узлов: открытая адресация с линейным пробированием по std::hash<Endpoint>,
+// заполненность не больше половины, удаление сдвигом назад (без надгробий).
+// При заполнении вытесняется узел, который дольше всех молчит.
+class PeerTable
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+private:
+	struct Slot
+	{
+		bool used = false;
+		PeerSession session;
+	};
+
+	std::vector<Slot> slots_;
+	size_t mask_;
+	size_t capacity_;
+	size_t size_ = 0;
+	size_t evicted_ = 0;
+
+	size_t home(const Endpoint& endpoint) const
+	{
+		return std::hash<Endpoint>{}(endpoint) & mask_;
+	}
+	size_t findIndex(const Endpoint& endpoint) const;
+	void eraseAt(size_t index);
+public:
+	explicit PeerTable(size_t capacity = 64);
+
+	PeerSession* find(const Endpoint& endpoint);
+	const PeerSession* find(const Endpoint& endpoint) const;
+
+	// Находит узел или добавляет новый и обновляет lastSeen
+	PeerSession& touch(const Endpoint& endpoint, Clock::time_point now = Clock::now());
+
+	bool erase(const Endpoint& endpoint);
+	// Удаляет узлы, от которых ничего не было дольше timeout; возвращает их число
+	size_t evictIdle(Clock::duration timeout, Clock::time_point now = Clock::now());
+	void clear();
+
+	template <typename F>
+	void forEach(F&& f) const
+	{
+		for(const Slot& slot : slots_)
+			if(slot.used)
+				f(slot.session);
+	}
+
+	size_t size() const { return size_; }
+	size_t capacity() const { return capacity_; }
+	size_t evictedCount() const { return evicted_; } // вытесненные из-за нехватки места
+};
+
+#endif
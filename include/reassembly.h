@@ -0,0 +1,80 @@
+#if !defined REASSEMBLY_H
+#define REASSEMBLY_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <vector>
+#include <chrono>
+#include <optional>
+
+#include <netaddress.h>
+
+// Заголовок фрагмента (после байта FrameFlags), все поля big-endian
+struct FragmentHeader
+{
+	uint16_t messageId;
+	uint16_t index;
+	uint16_t count;
+	uint16_t chunkSize; // размер всех фрагментов, кроме последнего
+
+	static constexpr size_t SIZE = 8;
+
+	void write(uint8_t* out) const noexcept;
+	static FragmentHeader read(const uint8_t* in) noexcept;
+};
+
+struct ReassembledMessage
+{
+	const uint8_t* data;  // действительно до следующего вызова ReassemblyTable::insert
+	size_t size;
+	uint8_t flags;
+};
+
+// Таблица сборки фрагментированных сообщений с фиксированным числом слотов.
+// Вся память выделяется в конструкторе; незавершённые сообщения вытесняются
+// по таймауту, а при нехватке слотов — самое старое из них.
+class ReassemblyTable
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+private:
+	struct Slot
+	{
+		bool active = false;
+		Endpoint peer{ IP_ANY, 0 };
+		uint16_t messageId = 0;
+		uint16_t count = 0;
+		uint16_t chunkSize = 0;
+		uint16_t received = 0;
+		uint8_t flags = 0;
+		size_t size = 0;
+		Clock::time_point started;
+		std::vector<uint8_t> mask;
+		std::vector<uint8_t> data;
+	};
+
+	std::vector<Slot> slots_;
+	size_t maxMessageSize_;
+	Clock::duration timeout_;
+	size_t evicted_ = 0;
+
+	Slot* findOrAllocate(const Endpoint& peer, uint16_t messageId, Clock::time_point now);
+public:
+	ReassemblyTable(size_t slots, size_t maxMessageSize, Clock::duration timeout);
+
+	// Возвращает собранное сообщение, если этот фрагмент был последним недостающим.
+	// Фрагмент, чьи count, chunkSize или флаги расходятся с уже принятыми фрагментами
+	// того же сообщения (например, после переполнения messageId), отбрасывается.
+	std::optional<ReassembledMessage> insert(const Endpoint& peer, uint8_t flags, const FragmentHeader& header,
+		const uint8_t* data, size_t size, Clock::time_point now = Clock::now());
+
+	// Освобождает слоты с истёкшим таймаутом; UDPTransmitter вызывает его из таймеров приёма
+	void evictExpired(Clock::time_point now = Clock::now());
+	void clear();
+
+	size_t maxMessageSize() const { return maxMessageSize_; }
+	size_t evictedCount() const { return evicted_; } // сообщения, потерянные из-за таймаута или нехватки слотов
+};
+
+#endif
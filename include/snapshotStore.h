@@ -0,0 +1,98 @@
+#if !defined SNAPSHOT_STORE_H
+#define SNAPSHOT_STORE_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <chrono>
+#include <type_traits>
+
+#include <netaddress.h>
+
+struct SnapshotInfo
+{
+	size_t size;        // полный размер последнего значения (скопировано не больше maxSize)
+	uint64_t version;   // номер записи в слот, растёт с каждым publish
+	std::chrono::steady_clock::time_point updated;
+};
+
+// Последнее значение для каждой пары (узел, канал). Один поток-писатель (обычно
+// поток приёма) публикует значения, любое число читателей читает без блокировок:
+// слот защищён seqlock, писатель не ждёт читателей и копирует данные один раз.
+// Ключи добавляются один раз и не удаляются; при заполнении новые ключи отбрасываются.
+class SnapshotStore
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+private:
+	struct alignas(64) Slot
+	{
+		std::atomic<bool> used{ false }; // ключ записан и опубликован
+		Endpoint peer{ NetAddress(), 0 };
+		uint32_t channel = 0;
+		std::atomic<uint64_t> sequence{ 0 }; // нечётное — идёт запись
+		std::atomic<uint64_t> size{ 0 };
+		std::atomic<int64_t> updated{ 0 };
+	};
+
+	std::unique_ptr<Slot[]> slots_;
+	// Данные слотов словами, чтобы одновременные запись и чтение не были гонкой данных
+	std::unique_ptr<std::atomic<uint64_t>[]> words_;
+	size_t mask_;
+	size_t capacity_;
+	size_t maxSize_;
+	size_t wordsPerSlot_;
+	std::atomic<size_t> size_{ 0 };
+	std::atomic<uint64_t> overflow_{ 0 };
+
+	size_t home(const Endpoint& peer, uint32_t channel) const
+	{
+		return (std::hash<Endpoint>{}(peer) ^ (channel + 1ull) * 0xC2B2AE3D27D4EB4Full) & mask_;
+	}
+	const Slot* find(const Endpoint& peer, uint32_t channel) const;
+	Slot* findOrInsert(const Endpoint& peer, uint32_t channel);
+	std::optional<SnapshotInfo> readSlot(const Slot& slot, uint8_t* buffer, size_t maxSize) const;
+
+public:
+	// capacity — число пар (узел, канал), maxSize — наибольший размер значения
+	SnapshotStore(size_t capacity = 64, size_t maxSize = 1200);
+
+	// Только из одного потока. Значение длиннее maxSize обрезается.
+	// false, если для нового ключа нет места.
+	bool publish(const Endpoint& peer, uint32_t channel, const uint8_t* data, size_t size, Clock::time_point now = Clock::now());
+
+	// Одна попытка без ожидания: nullopt, если ключа нет или писатель как раз обновляет слот
+	std::optional<SnapshotInfo> tryRead(const Endpoint& peer, uint32_t channel, uint8_t* buffer, size_t maxSize) const;
+	// Повторяет попытку, пока не прочитает согласованное значение; nullopt — ключа нет
+	std::optional<SnapshotInfo> read(const Endpoint& peer, uint32_t channel, uint8_t* buffer, size_t maxSize) const;
+
+	template <typename T>
+	bool publish(const Endpoint& peer, uint32_t channel, const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "SnapshotStore::publish<T> T must be trivially copyable");
+		return publish(peer, channel, reinterpret_cast<const uint8_t*>(&value), sizeof(T));
+	}
+
+	// Значение другого размера считается отсутствующим
+	template <typename T>
+	std::optional<T> read(const Endpoint& peer, uint32_t channel) const
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "SnapshotStore::read<T> T must be trivially copyable");
+		T value;
+		std::optional<SnapshotInfo> info = read(peer, channel, reinterpret_cast<uint8_t*>(&value), sizeof(T));
+		if(!info.has_value() || info->size != sizeof(T))
+			return std::nullopt;
+		return value;
+	}
+
+	size_t size() const { return size_.load(std::memory_order_relaxed); }
+	size_t capacity() const { return capacity_; }
+	size_t maxSize() const { return maxSize_; }
+	uint64_t overflowCount() const { return overflow_.load(std::memory_order_relaxed); } // не поместившиеся ключи
+};
+
+#endif
@@ -0,0 +1,76 @@
+#if !defined SUBNET_H
+#define SUBNET_H
+
+#include <inttypes.h>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <stdexcept>
+
+#include <ipaddress.h>
+
+// Подсеть IPv4 в записи CIDR (адрес/длина префикса). Биты узла в адресе обнуляются.
+class Subnet
+{
+	IPAddress network_;
+	uint8_t prefix_;
+
+public:
+	constexpr Subnet(IPAddress address, uint8_t prefix) :
+	network_(address & maskOf(prefix)), prefix_(prefix)
+	{}
+
+	static constexpr IPAddress maskOf(uint8_t prefix)
+	{
+		if(prefix > 32)
+			throw std::invalid_argument("Subnet::maskOf(uint8_t) prefix must be at most 32");
+		return IPAddress::fromHost(prefix == 0 ? 0 : ~0u << (32 - prefix));
+	}
+
+	// "10.0.0.0/8"; адрес без "/n" — подсеть из одного адреса (/32)
+	static constexpr std::optional<Subnet> fromString(std::string_view str) noexcept
+	{
+		size_t slash = str.find('/');
+		std::optional<IPAddress> address = IPAddress::fromString(str.substr(0, slash));
+		if(!address.has_value())
+			return std::nullopt;
+		if(slash == std::string_view::npos)
+			return Subnet(address.value(), 32);
+
+		std::string_view prefixStr = str.substr(slash + 1);
+		if(prefixStr.empty() || prefixStr.size() > 2)
+			return std::nullopt;
+		unsigned prefix = 0;
+		for(char c : prefixStr)
+		{
+			if(c < '0' || c > '9')
+				return std::nullopt;
+			prefix = prefix * 10 + (c - '0');
+		}
+		if(prefix > 32)
+			return std::nullopt;
+		return Subnet(address.value(), static_cast<uint8_t>(prefix));
+	}
+
+	constexpr IPAddress network() const noexcept { return network_; }
+	constexpr uint8_t prefix() const noexcept { return prefix_; }
+	constexpr IPAddress mask() const { return maskOf(prefix_); }
+
+	// Первый и последний адрес подсети, host-endian
+	constexpr uint32_t firstHost() const noexcept { return network_.toHost(); }
+	constexpr uint32_t lastHost() const { return network_.toHost() | ~mask().toHost(); }
+
+	constexpr bool contains(IPAddress address) const
+	{
+		return (address & mask()) == network_;
+	}
+
+	constexpr bool operator==(const Subnet& other) const noexcept = default;
+
+	std::string toString() const
+	{
+		return network_.toString() + '/' + std::to_string(prefix_);
+	}
+};
+
+#endif
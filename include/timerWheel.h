@@ -0,0 +1,168 @@
+#if !defined TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <bit>
+#include <stdexcept>
+
+// Хешированное колесо таймеров: slots ячеек по tick, в каждой — двусвязный список
+// узлов из общего пула. Запуск и отмена — O(1), advance просматривает только
+// ячейки прошедших тиков. Таймеры дальше одного оборота колеса лежат в своей ячейке
+// и срабатывают на нужном обороте. Точность — один tick, раньше срока таймер не срабатывает.
+template <typename T>
+class TimerWheel
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using Handle = uint32_t;
+	static constexpr Handle NONE = UINT32_MAX;
+
+private:
+	struct Node
+	{
+		T value{};
+		uint64_t tick = 0;
+		Handle prev = NONE;
+		Handle next = NONE;
+		bool active = false;
+	};
+
+	std::vector<Node> nodes_;
+	std::vector<Handle> free_;
+	std::vector<Handle> heads_;
+	std::vector<std::pair<Handle, T>> expired_;
+	Clock::duration tick_;
+	Clock::time_point start_;
+	uint64_t mask_;
+	uint64_t current_ = 0; // последний обработанный тик
+	size_t size_ = 0;
+
+	uint64_t tickOf(Clock::time_point deadline) const
+	{
+		if(deadline <= start_)
+			return current_ + 1;
+		uint64_t tick = static_cast<uint64_t>((deadline - start_ + tick_ - Clock::duration(1)) / tick_); // вверх
+		return tick > current_ ? tick : current_ + 1;
+	}
+
+	void link(Handle handle)
+	{
+		Node& node = nodes_[handle];
+		Handle& head = heads_[node.tick & mask_];
+		node.prev = NONE;
+		node.next = head;
+		if(head != NONE)
+			nodes_[head].prev = handle;
+		head = handle;
+	}
+
+	void unlink(Handle handle)
+	{
+		Node& node = nodes_[handle];
+		if(node.prev != NONE)
+			nodes_[node.prev].next = node.next;
+		else
+			heads_[node.tick & mask_] = node.next;
+		if(node.next != NONE)
+			nodes_[node.next].prev = node.prev;
+	}
+
+public:
+	// slots округляется вверх до степени двойки
+	TimerWheel(Clock::duration tick = std::chrono::milliseconds(1), size_t slots = 512, Clock::time_point now = Clock::now()) :
+	heads_(std::bit_ceil(slots < 2 ? size_t(2) : slots), NONE), tick_(tick), start_(now), mask_(heads_.size() - 1)
+	{
+		if(tick <= Clock::duration::zero())
+			throw std::invalid_argument("TimerWheel<T>::TimerWheel(Clock::duration, size_t, Clock::time_point) tick must be positive");
+	}
+
+	Handle schedule(Clock::time_point deadline, T value)
+	{
+		Handle handle;
+		if(!free_.empty())
+		{
+			handle = free_.back();
+			free_.pop_back();
+		}
+		else
+		{
+			handle = static_cast<Handle>(nodes_.size());
+			nodes_.emplace_back();
+		}
+		Node& node = nodes_[handle];
+		node.value = std::move(value);
+		node.tick = tickOf(deadline);
+		node.active = true;
+		link(handle);
+		++size_;
+		return handle;
+	}
+
+	void reschedule(Handle handle, Clock::time_point deadline)
+	{
+		if(handle >= nodes_.size() || !nodes_[handle].active)
+			return;
+		unlink(handle);
+		nodes_[handle].tick = tickOf(deadline);
+		link(handle);
+	}
+
+	bool cancel(Handle handle)
+	{
+		if(handle >= nodes_.size() || !nodes_[handle].active)
+			return false;
+		unlink(handle);
+		nodes_[handle].active = false;
+		free_.push_back(handle);
+		--size_;
+		return true;
+	}
+
+	// Вызывает f(handle, value) для каждого истёкшего таймера в порядке ячеек.
+	// К вызову таймер уже снят, его handle может быть выдан снова; f может запускать
+	// и отменять таймеры. Возвращает число сработавших.
+	template <typename F>
+	size_t advance(Clock::time_point now, F&& f)
+	{
+		if(now < start_)
+			return 0;
+		uint64_t target = static_cast<uint64_t>((now - start_) / tick_);
+		if(target <= current_)
+			return 0;
+		uint64_t steps = target - current_ < heads_.size() ? target - current_ : heads_.size();
+
+		expired_.clear();
+		for(uint64_t step = 1; step <= steps; ++step)
+		{
+			Handle handle = heads_[(current_ + step) & mask_];
+			while(handle != NONE)
+			{
+				Node& node = nodes_[handle];
+				Handle next = node.next;
+				if(node.tick <= target)
+				{
+					unlink(handle);
+					node.active = false;
+					free_.push_back(handle);
+					--size_;
+					expired_.emplace_back(handle, std::move(node.value));
+				}
+				handle = next;
+			}
+		}
+		current_ = target;
+
+		for(auto& [handle, value] : expired_)
+			f(handle, value);
+		return expired_.size();
+	}
+
+	size_t size() const { return size_; }
+	Clock::duration tick() const { return tick_; }
+};
+
+#endif
@@ -0,0 +1,50 @@
+#if !defined TRANSPORT_HANDLE_H
+#define TRANSPORT_HANDLE_H
+
+#include <memory>
+#include <utility>
+
+// Транспорт, которым объект владеет (свой UDPSocket) или который ему передали снаружи.
+// Указатель хранится в обоих случаях, поэтому обращение — одна загрузка без ветвления,
+// а собственный транспорт лежит в куче и не меняет адрес при перемещении владельца.
+template <typename T>
+class TransportHandle
+{
+	std::unique_ptr<T> owned_;
+	T* transport_ = nullptr;
+public:
+	TransportHandle() = default;
+
+	template <typename U>
+	explicit TransportHandle(std::unique_ptr<U> owned) :
+	owned_(std::move(owned)), transport_(owned_.get())
+	{}
+
+	explicit TransportHandle(T* borrowed) :
+	transport_(borrowed)
+	{}
+
+	TransportHandle(const TransportHandle&) = delete;
+	TransportHandle& operator=(const TransportHandle&) = delete;
+
+	TransportHandle(TransportHandle&& other) noexcept :
+	owned_(std::move(other.owned_)), transport_(std::exchange(other.transport_, nullptr))
+	{}
+
+	TransportHandle& operator=(TransportHandle&& other) noexcept
+	{
+		if(this != &other)
+		{
+			owned_ = std::move(other.owned_);
+			transport_ = std::exchange(other.transport_, nullptr);
+		}
+		return *this;
+	}
+
+	T& operator*() const { return *transport_; }
+	T* operator->() const { return transport_; }
+	T* get() const { return transport_; }
+	bool owns() const { return owned_ != nullptr; }
+};
+
+#endif
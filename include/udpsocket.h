@@ -44,7 +44,7 @@ using socket_t = int;
 #include <chrono>
 
 #include <message.h>
-#include <ipaddress.h>
+#include <netaddress.h>
 
 
 enum class UDPError {
@@ -76,32 +76,108 @@ std::string udp_error_to_string(UDPError err);
 struct ReceiveInfo
 {
 	size_t dataSize;
-	std::optional<IPAddress> remoteIP;
+	std::optional<IPAddress> remoteIP; // только для отправителей IPv4
+	uint16_t remotePort = 0; // host-endian
+	NetAddress remoteAddress{}; // адрес отправителя v4 или v6 (IPv4 — как IPv4-mapped)
+	std::optional<uint32_t> sequence{}; // номер сообщения, если отправитель включил setSequencing
+	bool filtered = false; // датаграмма была, но транспорт её отбросил: очередь может быть непуста
+
+	Endpoint remoteEndpoint() const { return Endpoint{ remoteAddress, remotePort }; }
+
+	ReceiveInfo withSize(size_t size) const
+	{
+		ReceiveInfo info = *this;
+		info.dataSize = size;
+		return info;
+	}
 };
 
 inline bool recieved(ReceiveInfo rcInfo)
 {
-	return rcInfo.remoteIP.has_value();
+	return rcInfo.remoteIP.has_value() || !rcInfo.remoteAddress.isUnspecified();
 }
 
 inline constexpr ReceiveInfo RECEIVE_NONE(0, std::nullopt);
+inline constexpr ReceiveInfo RECEIVE_FILTERED(0, std::nullopt, 0, NetAddress{}, std::nullopt, true);
+
+// Очередь транспорта пуста; RECEIVE_FILTERED (например, своя датаграмма при
+// selfFilter) — ещё нет, вычитывающий цикл должен продолжать
+inline bool wouldBlock(ReceiveInfo rcInfo)
+{
+	return !recieved(rcInfo) && !rcInfo.filtered;
+}
+
+// Датаграмма из частей (заголовок + данные + необязательный хвост, например
+// контрольная сумма), отправляется без склейки в общий буфер
+struct DatagramView
+{
+	const uint8_t* header;
+	size_t headerSize;
+	const uint8_t* payload;
+	size_t payloadSize;
+	const uint8_t* trailer = nullptr;
+	size_t trailerSize = 0;
+};
 
 
 std::vector<IPAddress> intefacesIPs();
 
-class UDPSocket
+// Источник и приёмник датаграмм под UDPTransmitter: сокет ОС (UDPSocket),
+// очередь в памяти (LoopbackTransport) или эмулятор сети поверх другого
+// транспорта (NetemTransport). Порты и адреса — в тех же порядках байт, что у UDPSocket.
+class Transport
 {
-	socket_t sock_;
+public:
+	virtual ~Transport() = default;
+
+	// Отправка на адрес ip и порт, к которому привязан транспорт
+	virtual std::variant<size_t, UDPError> send_batch(const DatagramView* datagrams, size_t count, IPAddress ip) = 0;
+	virtual std::variant<size_t, UDPError> send_batch(const DatagramView* datagrams, const Endpoint* destinations, size_t count) = 0;
+	// Не блокирует: если датаграмм нет, возвращает RECEIVE_NONE, если датаграмма
+	// отброшена самим транспортом — RECEIVE_FILTERED
+	virtual std::variant<ReceiveInfo, UDPError> recieve(uint8_t* buf, size_t size) = 0;
+
+	virtual uint16_t getBindPort() = 0; // host-endian
+	virtual uint32_t getBindInterface() = 0; // big-endian
+};
+
+class UDPSocket : public Transport
+{
+	socket_t sock_ = INVALID_SOCKET;
 	uint16_t port_;
 	uint32_t intefaceIP_;
+	int receiveBufferSize_ = 0; // 0 — значение ОС по умолчанию
+	int sendBufferSize_ = 0;
+	uint64_t pacingRate_ = 0; // байт/с, 0 — без ограничения
+	bool dualStack_ = false;
+	bool selfFilter_ = true;
+	// Адреса своих интерфейсов для selfFilter_: обновляются при bind и раз в
+	// LOCAL_ADDRESSES_TTL, чтобы приём не вызывал getifaddrs и не выделял память на каждом пакете
+	std::vector<IPAddress> localIPs_;
+	std::chrono::steady_clock::time_point localIPsUpdated_;
+
+	struct MulticastMembership
+	{
+		IPAddress group;
+		IPAddress interfaceIP;
+	};
+	std::vector<MulticastMembership> groups_;
+	IPAddress multicastInterface_ = IPAddress(0, 0, 0, 0);
+	int multicastTTL_ = 1;
+	bool multicastLoop_ = true;
 
 	std::optional<UDPError> bind(); 
+	std::optional<UDPError> applyPacingRate();
+	std::optional<UDPError> applyMembership(const MulticastMembership& membership, bool join);
+	std::optional<UDPError> applyMulticastOptions();
+	bool isLocalAddress(IPAddress ip);
 public:
+	static constexpr std::chrono::seconds LOCAL_ADDRESSES_TTL{ 10 };
 
 	UDPSocket() = delete;
 	explicit UDPSocket(uint16_t port); // big-endian
 	UDPSocket(uint16_t port, IPAddress p); // big-endian
-	~UDPSocket();
+	~UDPSocket() override;
 
 	UDPSocket(const UDPSocket&) = delete;
 	UDPSocket(UDPSocket&& other) noexcept;
@@ -118,10 +194,45 @@ public:
 	std::variant<size_t, UDPError> send_to(const uint8_t* data, size_t size, uint32_t ip); // ip should be big-endian
 	std::variant<size_t, UDPError> send_to(const uint8_t* data, size_t size, IPAddress ip);
 
-	std::variant<ReceiveInfo, UDPError> recieve(uint8_t* buf, size_t size);
-
-	uint16_t getBindPort();
-	uint32_t getBindInterface();
+	// Отправляет count датаграмм минимальным числом системных вызовов (sendmmsg на Linux),
+	// возвращает количество отправленных датаграмм
+	std::variant<size_t, UDPError> send_batch(const DatagramView* datagrams, size_t count, IPAddress ip) override;
+	// То же, но каждая датаграмма уходит своему адресату destinations[i]
+	std::variant<size_t, UDPError> send_batch(const DatagramView* datagrams, const Endpoint* destinations, size_t count) override;
+
+	std::variant<ReceiveInfo, UDPError> recieve(uint8_t* buf, size_t size) override;
+
+	uint16_t getBindPort() override;
+	uint32_t getBindInterface() override;
+
+	// Размеры буферов ядра (SO_RCVBUF/SO_SNDBUF), сохраняются при повторном bind
+	std::optional<UDPError> setReceiveBufferSize(int bytes);
+	std::optional<UDPError> setSendBufferSize(int bytes);
+
+	// Равномерная отправка силами ядра (SO_MAX_PACING_RATE, Linux; для UDP нужна
+	// дисциплина очереди fq). 0 снимает ограничение. Где опции нет — OPERATION_NOT_SUPPORTED.
+	std::optional<UDPError> setMaxPacingRate(uint64_t bytesPerSecond);
+
+	// Двойной стек: сокет AF_INET6 без IPV6_V6ONLY принимает и отправляет и IPv4
+	// (как IPv4-mapped), и IPv6. Сокет пересоздаётся. По умолчанию — только IPv4.
+	std::optional<UDPError> setDualStack(bool enable);
+	bool getDualStack() const { return dualStack_; }
+
+	// Multicast IPv4 (IP_ADD_MEMBERSHIP/IP_DROP_MEMBERSHIP). Членство и параметры
+	// сохраняются при повторном bind. interfaceIP — адрес интерфейса, IP_ANY — выбор ОС.
+	std::optional<UDPError> joinGroup(IPAddress group, IPAddress interfaceIP = IPAddress(0, 0, 0, 0));
+	std::optional<UDPError> leaveGroup(IPAddress group, IPAddress interfaceIP = IPAddress(0, 0, 0, 0));
+	// Интерфейс, TTL и петля (доставка своих пакетов себе) для исходящего multicast
+	std::optional<UDPError> setMulticastInterface(IPAddress interfaceIP);
+	std::optional<UDPError> setMulticastTTL(uint8_t ttl);
+	std::optional<UDPError> setMulticastLoop(bool enable);
+
+	// Отбрасывание пакетов с адресов своих интерфейсов (включено по умолчанию).
+	// Для multicast вместо него достаточно выключить петлю.
+	void setSelfFilter(bool enable) { selfFilter_ = enable; }
+	bool getSelfFilter() const { return selfFilter_; }
+	// Перечитывает адреса интерфейсов сейчас, не дожидаясь LOCAL_ADDRESSES_TTL
+	void refreshLocalAddresses();
 
 };
 
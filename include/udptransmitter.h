@@ -3,50 +3,261 @@
 
 #include <iostream>
 #include <cstring>
+#include <vector>
+#include <memory>
+#include <chrono>
 
 #include <udpsocket.h>
+#include <reassembly.h>
+#include <fec.h>
+#include <peerTable.h>
+#include <magicTag.h>
+#include <crc32c.h>
+#include <pacer.h>
+#include <addressFilter.h>
+#include <capture.h>
+#include <timerWheel.h>
+#include <transportHandle.h>
+#include <functional>
 
+// Флаги байта заголовка, который следует за magic-строкой в расширенном режиме
+enum FrameFlags : uint8_t
+{
+	FRAME_COMPRESSED = 1 << 0,
+	FRAME_FRAGMENT = 1 << 1,     // далее FragmentHeader
+	FRAME_FEC = 1 << 2,          // далее FecHeader, идёт перед остальными заголовками
+	FRAME_SEQUENCE = 1 << 3,     // далее номер сообщения uint32_t big-endian (перед FragmentHeader)
+	FRAME_CHECKSUM = 1 << 4,     // в конце датаграммы CRC-32C всех предыдущих байт (big-endian)
+	FRAME_BATCH = 1 << 5,        // данные — несколько сообщений, каждое с длиной (varint) впереди
+	FRAME_CONTROL = 1 << 6,      // служебный кадр (байт вида, затем тело), приложению не отдаётся
+	FRAME_KNOWN_FLAGS = FRAME_COMPRESSED | FRAME_FRAGMENT | FRAME_FEC | FRAME_SEQUENCE | FRAME_CHECKSUM | FRAME_BATCH | FRAME_CONTROL
+};
 
+// Причины, по которым принятые датаграммы не были доставлены
+struct DropStats
+{
+	uint64_t foreign = 0;     // чужая magic-строка
+	uint64_t malformed = 0;   // неизвестные флаги, обрезанные заголовки, ошибка распаковки
+	uint64_t corrupted = 0;   // не сошлась контрольная сумма
+	uint64_t rejected = 0;    // отправитель отличается от заблокированного target (для служебных кадров — и от резервных)
+	uint64_t filtered = 0;    // отправитель запрещён фильтром подсетей
+};
 
 class UDPTransmitter 
 {
-	std::variant<UDPSocket, UDPSocket*> sock_ = nullptr;
+	// Всё, что читается на каждом пакете (транспорт, magic, адресат, флаги режимов), —
+	// в начале объекта, в первой кэш-линии; настройки и буферы — дальше
+	TransportHandle<Transport> transport_;
+	// magic-строки из 4 и 8 байт сравниваются одной целочисленной загрузкой, как MagicTag
+	uint64_t magicWord64_ = 0;
+	uint32_t magicWord32_ = 0;
 	IPAddress target_;
-	
+	bool lockTargetIP_ = false;
+	// Расширенный режим: после magic-строки идёт байт FrameFlags.
+	// Включается вместе с любой из опций ниже и должен совпадать у обеих сторон.
+	bool extendedHeader_ = false;
+	bool compression_ = false;
+	bool fragmentation_ = false;
+	bool checksum_ = false;
+	bool coalescing_ = false;
+	bool sequencing_ = false;
+	bool dropStale_ = false;
+	bool clockSync_ = false;
+	bool heartbeat_ = false;
 	std::string magicString_;
-	bool lockTargetIP_;
 
-	UDPSocket& sock()
+	std::optional<IPAddress> multicastGroup_; // режим группы: target_ — эта группа
+	IPAddress multicastInterface_ = IP_ANY;
+
+	size_t compressionThreshold_ = 0;
+	size_t maxDatagramSize_ = 0;
+	uint16_t nextMessageId_ = 0;
+	std::unique_ptr<ReassemblyTable> reassembly_;
+	std::unique_ptr<FecEncoder> fecEncoder_;
+	std::unique_ptr<FecDecoder> fecDecoder_;
+
+	DropStats drops_;
+	std::unique_ptr<AddressFilter> sourceFilter_;
+	CaptureWriter* capture_ = nullptr;
+	CaptureReader* replay_ = nullptr;
+	double replaySpeed_ = 0;
+	std::optional<std::chrono::system_clock::time_point> replayOrigin_; // время первой воспроизведённой записи
+	std::chrono::steady_clock::time_point replayStarted_;
+	std::unique_ptr<TokenBucket> pacer_;
+	// Датаграммы, ждущие токенов: копии байт в pacedData_ и срок отправки. Сроки не убывают
+	// (их выдаёт один токен-бакет), поэтому хватает очереди; разбирает её serviceTimers.
+	struct PacedDatagram
 	{
-		if(std::holds_alternative<UDPSocket>(sock_))
-			return std::get<UDPSocket>(sock_);
-		return *std::get<UDPSocket*>(sock_);
+		std::chrono::steady_clock::time_point deadline;
+		Endpoint destination;
+		size_t offset;
+		size_t size;
+	};
+	std::vector<PacedDatagram> paced_;
+	size_t pacedHead_ = 0;
+	std::vector<uint8_t> pacedData_;
+	std::vector<DatagramView> pacedViews_;
+	std::vector<Endpoint> pacedEndpoints_;
+
+	size_t coalesceLimit_ = 0;
+	std::chrono::microseconds coalesceDeadline_{ 0 };
+	std::chrono::steady_clock::time_point coalesceStarted_;
+	std::vector<uint8_t> coalesceBuf_;
+	size_t coalesceSize_ = 0;
+	std::vector<uint8_t> batchBuf_;    // принятый пакет сообщений
+	size_t batchSize_ = 0;
+	size_t batchRead_ = 0;
+	ReceiveInfo batchInfo_ = RECEIVE_NONE;
+	std::vector<uint8_t> checksumBuf_;
+	std::vector<DatagramView> checksumDatagrams_;
+
+	uint32_t nextSequence_ = 0; // поток адресата не из таблицы; растёт с каждым сообщением, см. openStream
+	uint32_t sharedFloor_ = 0; // номер после последнего кадра общего потока: потоки узлов не ниже него
+	std::optional<uint32_t> deliveredSequence_; // номер кадра последнего отданного сообщения (и записей пакета)
+	std::vector<uint8_t> latestBuf_;
+
+	std::chrono::milliseconds clockInterval_{ 1000 };
+	std::chrono::steady_clock::time_point lastClockProbe_;
+
+	std::chrono::milliseconds heartbeatInterval_{ 10 };
+	std::chrono::milliseconds livenessTimeout_{ 30 };
+	std::chrono::steady_clock::time_point lastHeartbeat_;
+	TimerWheel<Endpoint> livenessTimers_;
+	std::function<void(const Endpoint&, bool)> livenessHandler_;
+	std::vector<IPAddress> failoverTargets_;
+	bool failoverBroadcast_ = true;
+	std::optional<IPAddress> primaryTarget_; // адресат до переключения на резервный
+	uint64_t failovers_ = 0;
+
+	PeerTable peers_;
+	std::vector<Endpoint> destinations_; // адресаты sendDataTo/sendDataToAll, пусто — target_
+	std::vector<Endpoint> streamDestinations_;
+	std::vector<DatagramView> fanoutDatagrams_;
+	std::vector<Endpoint> fanoutEndpoints_;
+
+	std::vector<uint8_t> sendBuf_;     // заголовки отправляемых датаграмм
+	std::vector<uint8_t> compressBuf_;
+	std::vector<uint8_t> recvBuf_;
+	std::vector<DatagramView> datagrams_;
+	std::vector<uint8_t> fecSendBuf_;
+	std::vector<DatagramView> fecDatagrams_;
+
+	Transport& transport()
+	{
+		return *transport_;
+	}
+
+	// Сокет ОС под транспортом или nullptr, если транспорт другой (настройки сокета недоступны)
+	UDPSocket* udpSocket()
+	{
+		return dynamic_cast<UDPSocket*>(transport_.get());
+	}
+
+	void initMagicWord()
+	{
+		if(magicString_.length() == 4)
+			memcpy(&magicWord32_, magicString_.data(), 4);
+		else if(magicString_.length() == 8)
+			memcpy(&magicWord64_, magicString_.data(), 8);
 	}
+
+	bool checkMagic(const uint8_t* data, size_t size) const
+	{
+		size_t magicSize = magicString_.length();
+		if(size < magicSize)
+			return false;
+		if(magicSize == 4)
+		{
+			uint32_t word;
+			memcpy(&word, data, 4);
+			return word == magicWord32_;
+		}
+		if(magicSize == 8)
+		{
+			uint64_t word;
+			memcpy(&word, data, 8);
+			return word == magicWord64_;
+		}
+		return memcmp(magicString_.c_str(), data, magicSize) == 0;
+	}
+
+	bool acceptSender(std::optional<IPAddress> remoteIP);
+	bool acceptControlSender(std::optional<IPAddress> remoteIP) const;
+	bool restorePrimary(std::optional<IPAddress> remoteIP);
+	bool filterSender(const ReceiveInfo& info);
+	size_t writeHeader(uint8_t* out, uint8_t flags, uint32_t sequence) const;
+	bool acceptSequence(const Endpoint& peer, uint32_t sequence);
+	ssize_t sendControlFrame(const uint8_t* body, size_t bodySize, const Endpoint* peer);
+	ssize_t sendClockFrame(uint8_t kind, int64_t t1, int64_t t2, const Endpoint* peer);
+	void handleControlFrame(const uint8_t* payload, size_t payloadSize, const Endpoint& peer, std::chrono::steady_clock::time_point received);
+	void serviceTimers(std::chrono::steady_clock::time_point now);
+	void enqueuePaced(const DatagramView& datagram, const Endpoint& destination, std::chrono::steady_clock::time_point deadline);
+	void drainPaced(std::chrono::steady_clock::time_point now);
+	void sendHeartbeats(std::chrono::steady_clock::time_point now);
+	void watchPeer(PeerSession& session);
+	void peerExpired(TimerWheel<Endpoint>::Handle timer, const Endpoint& peer, std::chrono::steady_clock::time_point now);
+	void failover(IPAddress dead);
+	std::variant<ReceiveInfo, UDPError> receiveDatagram(uint8_t* buffer, size_t maxSize, const uint8_t*& data);
+	ReceiveInfo receiveImpl(uint8_t* buffer, size_t maxSize, bool* socketEmpty);
+	ReceiveInfo receiveLegacy(uint8_t* buffer, size_t maxSize, bool* socketEmpty);
+	ReceiveInfo processDatagram(const uint8_t* data, size_t size, ReceiveInfo info, uint8_t* buffer, size_t maxSize);
+	ReceiveInfo processFrame(uint8_t flags, const uint8_t* payload, size_t payloadSize, ReceiveInfo info, uint8_t* buffer, size_t maxSize);
+	ReceiveInfo deliverPayload(uint8_t flags, const uint8_t* payload, size_t payloadSize, ReceiveInfo info, uint8_t* buffer, size_t maxSize);
+	ReceiveInfo deliverRecovered(uint8_t* buffer, size_t maxSize);
+	ReceiveInfo deliverBatched(uint8_t* buffer, size_t maxSize);
+	FecEncoder* openStream(PeerSession& session, uint32_t sequence);
+	ssize_t sendMessage(const uint8_t* data, size_t dataSize, uint8_t flags);
+	ssize_t sendFrame(const uint8_t* payload, size_t payloadSize, uint8_t flags, uint32_t sequence, FecEncoder* fec);
+	ssize_t sendFragments(const uint8_t* payload, size_t payloadSize, uint8_t flags, uint32_t sequence, FecEncoder* fec);
+	ssize_t sendDatagrams(const DatagramView* datagrams, size_t count, FecEncoder* fec);
+	ssize_t sendProtected(const DatagramView* datagrams, size_t count, FecEncoder& encoder);
+	ssize_t sendBatch(const DatagramView* datagrams, size_t count);
+	std::variant<size_t, UDPError> transmit(const DatagramView* datagrams, const Endpoint* destinations, size_t count);
 public:
 	UDPTransmitter(uint16_t port, std::string magicString) :
-	 target_(IP_BROADCAST), magicString_(std::move(magicString)), lockTargetIP_(false)
+	transport_(std::make_unique<UDPSocket>(hton(port))), target_(IP_BROADCAST), magicString_(std::move(magicString))
 	{
-		sock_ = UDPSocket(hton(port));
-		lockTargetIP_ = false;
+		initMagicWord();
 	}
 
-	UDPTransmitter(UDPSocket* sock, std::string magicString) :
-	sock_(sock), target_(IP_BROADCAST), magicString_(std::move(magicString))
+	// Поверх чужого транспорта: UDPSocket, LoopbackTransport, NetemTransport и т. п.
+	// Транспорт должен жить дольше передатчика.
+	UDPTransmitter(Transport* transport, std::string magicString) :
+	transport_(transport), target_(IP_BROADCAST), magicString_(std::move(magicString))
+	{
+		initMagicWord();
+	}
+
+	// Метка фиксированной ширины; совместима с magic-строкой из тех же символов
+	template <size_t N>
+	UDPTransmitter(uint16_t port, MagicTag<N> tag) : UDPTransmitter(port, tag.toString())
 	{}
 
-	uint16_t getBindPort()
+	template <size_t N>
+	UDPTransmitter(Transport* transport, MagicTag<N> tag) : UDPTransmitter(transport, tag.toString())
+	{}
+
+	// Перемещение оставляет свой сокет в куче на месте, поэтому передатчики можно
+	// хранить в std::vector; перемещённый объект пригоден только для уничтожения и присваивания
+	UDPTransmitter(UDPTransmitter&&) noexcept = default;
+	UDPTransmitter& operator=(UDPTransmitter&&) noexcept = default;
+	UDPTransmitter(const UDPTransmitter&) = delete;
+	UDPTransmitter& operator=(const UDPTransmitter&) = delete;
+
+	uint16_t getBindPort() // host-endian
 	{
-		return ntoh(sock().getBindPort());
+		return transport().getBindPort();
 	}
 
 	IPAddress getBindInterface()
 	{
-		return IPAddress::fromNet(sock().getBindInterface());
+		return IPAddress::fromNet(transport().getBindInterface());
 	}
 
 	bool bind(uint16_t port) // host-endian, returns true if success
 	{
-		std::optional<UDPError> rc = sock().bind(hton(port));
+		UDPSocket* socket = udpSocket();
+		std::optional<UDPError> rc = socket ? socket->bind(hton(port)) : UDPError::OPERATION_NOT_SUPPORTED;
 		if(!rc.has_value())
 			return true;
 		std::cerr << udp_error_to_string(rc.value()) << std::endl;
@@ -55,13 +266,90 @@ public:
 
 	bool bindInterface(IPAddress ip) // returns true if success
 	{
-		std::optional<UDPError> rc = sock().bindInteface(ip);
+		UDPSocket* socket = udpSocket();
+		std::optional<UDPError> rc = socket ? socket->bindInteface(ip) : UDPError::OPERATION_NOT_SUPPORTED;
+		if(!rc.has_value())
+			return true;
+		std::cerr << udp_error_to_string(rc.value()) << std::endl;
+		return false;
+	}
+
+
+	bool setReceiveBufferSize(int bytes) // returns true if success
+	{
+		UDPSocket* socket = udpSocket();
+		std::optional<UDPError> rc = socket ? socket->setReceiveBufferSize(bytes) : UDPError::OPERATION_NOT_SUPPORTED;
 		if(!rc.has_value())
 			return true;
 		std::cerr << udp_error_to_string(rc.value()) << std::endl;
 		return false;
 	}
 
+	// Двойной стек IPv4/IPv6 (см. UDPSocket::setDualStack), сокет пересоздаётся
+	bool setDualStack(bool enable) // returns true if success
+	{
+		UDPSocket* socket = udpSocket();
+		std::optional<UDPError> rc = socket ? socket->setDualStack(enable) : UDPError::OPERATION_NOT_SUPPORTED;
+		if(!rc.has_value())
+			return true;
+		std::cerr << udp_error_to_string(rc.value()) << std::endl;
+		return false;
+	}
+
+	// Режим multicast вместо широковещания: сокет вступает в группу group (IPv4, 224.0.0.0/4),
+	// и она становится адресатом по умолчанию, не меняющимся от входящих пакетов.
+	// Петлю ядро отключает (loop = false), поэтому фильтр своих пакетов по адресам
+	// интерфейсов не нужен и выключается; с loop = true свои пакеты возвращаются.
+	bool setMulticastGroup(IPAddress group, uint8_t ttl = 1, bool loop = false, IPAddress interfaceIP = IP_ANY); // returns true if success
+	// Выход из группы и возврат к широковещанию
+	void leaveMulticastGroup();
+
+	std::optional<IPAddress> getMulticastGroup() const
+	{
+		return multicastGroup_;
+	}
+
+	// Принимать датаграммы только от адресов, разрешённых фильтром (проверяется до
+	// смены target_). Отправители IPv6 получают действие фильтра по умолчанию.
+	void setSourceFilter(AddressFilter filter)
+	{
+		sourceFilter_ = std::make_unique<AddressFilter>(std::move(filter));
+		sourceFilter_->intervalCount(); // компилируем сейчас, а не на первом пакете
+	}
+
+	void clearSourceFilter()
+	{
+		sourceFilter_.reset();
+	}
+
+	const AddressFilter* getSourceFilter() const
+	{
+		return sourceFilter_.get();
+	}
+
+	// Записывать каждую принятую датаграмму (до проверок magic и фильтров) в writer.
+	// writer должен жить дольше передатчика или до setCapture(nullptr).
+	void setCapture(CaptureWriter* writer)
+	{
+		capture_ = writer;
+	}
+
+	// Брать датаграммы из записи вместо сокета. speed = 0 — без пауз, как можно быстрее,
+	// иначе с исходными интервалами, ускоренными в speed раз. После конца записи
+	// receiveData возвращает RECEIVE_NONE; setReplay(nullptr) возвращает приём из сокета.
+	void setReplay(CaptureReader* reader, double speed = 0)
+	{
+		if(speed < 0)
+			throw std::invalid_argument("void UDPTransmitter::setReplay(CaptureReader*, double) speed must not be negative");
+		replay_ = reader;
+		replaySpeed_ = speed;
+		replayOrigin_.reset();
+	}
+
+	bool isReplaying() const
+	{
+		return replay_ != nullptr;
+	}
 
 	void setLockTargetIP(bool lock)
 	{
@@ -84,6 +372,7 @@ public:
 	{
 		lockTargetIP_ = lockTargetIP;
 		target_ = targetIP;
+		primaryTarget_.reset();
 	}
 
 	void setBroadcastTargetIP()
@@ -96,23 +385,331 @@ public:
 		setTargetIP(IP_BROADCAST, false);
 	}
 
-	bool isValid() { return true; } // This method is not necessary, it is needed for better compatibility with the original library.
+	// Сжатие полезной нагрузки (LZ-кодек из compression.h) для сообщений не короче threshold байт.
+	// Несжимаемые данные отправляются как есть. Включает расширенный заголовок,
+	// поэтому должно быть включено на обеих сторонах.
+	void setCompression(bool enable, size_t threshold = 64)
+	{
+		compression_ = enable;
+		compressionThreshold_ = threshold;
+		if(enable)
+			extendedHeader_ = true;
+	}
+
+	bool getCompression() const
+	{
+		return compression_;
+	}
 
-	ssize_t sendData(const uint8_t* data, size_t dataSize)
+	// Разбиение сообщений, не помещающихся в maxDatagramSize байт, на фрагменты и их сборка
+	// на приёме. Сборка идёт в slots заранее выделенных буферов по maxMessageSize байт;
+	// незавершённое сообщение отбрасывается через timeout после первого фрагмента.
+	void setFragmentation(bool enable, size_t maxDatagramSize = 1200, size_t maxMessageSize = 1 << 20,
+		size_t slots = 4, std::chrono::milliseconds timeout = std::chrono::milliseconds(500))
 	{
-		uint8_t* buf = new uint8_t[dataSize + magicString_.length()];
-		memcpy(buf, magicString_.c_str(), magicString_.length());
-		memcpy(buf + magicString_.length(), data, dataSize);
-		std::variant<size_t, UDPError> rc = sock().send_to(buf, dataSize + magicString_.length(), target_);
-		if(std::holds_alternative<UDPError>(rc))
+		fragmentation_ = enable;
+		maxDatagramSize_ = maxDatagramSize;
+		if(enable)
 		{
-			std::cerr << udp_error_to_string(std::get<UDPError>(rc)) << std::endl;
-			return -1;
+			extendedHeader_ = true;
+			reassembly_ = std::make_unique<ReassemblyTable>(slots, maxMessageSize, timeout);
 		}
-		delete[] buf;
-		return std::get<size_t>(rc);
+		else
+			reassembly_.reset();
 	}
 
+	bool getFragmentation() const
+	{
+		return fragmentation_;
+	}
+
+	// Прямая коррекция ошибок: после каждых k кадров отправляются m parity-кадров
+	// (XOR при m == 1, иначе Рида-Соломона над GF(256)), по которым получатель
+	// восстанавливает до m потерянных кадров блока без повторной передачи.
+	// Кадры длиннее maxFrameSize байт отправляются без защиты. На приёме k и m задают
+	// наибольший размер блока, который удастся восстановить.
+	void setFec(bool enable, uint8_t k = 8, uint8_t m = 1, size_t maxFrameSize = 1500, size_t slots = 4)
+	{
+		if(enable && (k == 0 || m == 0 || k + m > 255))
+			throw std::invalid_argument("UDPTransmitter::setFec(bool, uint8_t, uint8_t, size_t, size_t) k and m must be positive and k + m <= 255");
+		if(enable)
+		{
+			extendedHeader_ = true;
+			fecEncoder_ = std::make_unique<FecEncoder>(k, m, maxFrameSize);
+			fecDecoder_ = std::make_unique<FecDecoder>(slots, k, m, maxFrameSize);
+		}
+		else
+		{
+			fecEncoder_.reset();
+			fecDecoder_.reset();
+		}
+	}
+
+	bool getFec() const
+	{
+		return fecEncoder_ != nullptr;
+	}
+
+	// CRC-32C в конце каждой датаграммы (аппаратная инструкция, если есть); датаграммы
+	// с неверной суммой отбрасываются и учитываются в dropStats().corrupted.
+	// Кадры с суммой проверяются всегда, опция управляет только отправкой.
+	void setChecksum(bool enable)
+	{
+		checksum_ = enable;
+		if(enable)
+			extendedHeader_ = true;
+	}
+
+	bool getChecksum() const
+	{
+		return checksum_;
+	}
+
+	const DropStats& dropStats() const
+	{
+		return drops_;
+	}
+
+	// Ограничение скорости отправки: в среднем bytesPerSecond, пачками не больше burst байт.
+	// Датаграммы сверх токенов не ждут на месте, а встают в очередь со сроком отправки
+	// и уходят из receiveData и poll(), поэтому отправка (в том числе служебные кадры
+	// на пути приёма) не блокируется; в паузах нужно вызывать poll(). Размер очереди —
+	// pacingBacklog(), при уничтожении передатчика она теряется. 0 — без ограничения,
+	// очередь при этом отправляется сразу.
+	// Дополнительно включается SO_MAX_PACING_RATE, где он есть; false — опцию выставить
+	// не удалось (ограничение в библиотеке при этом действует). SO_TXTIME не используется:
+	// ему нужны дисциплина etf и метка времени в каждом sendmsg, а очередь работает
+	// на любом транспорте.
+	bool setPacing(uint64_t bytesPerSecond, size_t burst = 16 * 1024) // returns true if success
+	{
+		if(bytesPerSecond == 0)
+		{
+			drainPaced(std::chrono::steady_clock::time_point::max());
+			pacer_.reset();
+		}
+		else
+			pacer_ = std::make_unique<TokenBucket>(bytesPerSecond, burst);
+		UDPSocket* socket = udpSocket();
+		if(!socket)
+			return true;
+		std::optional<UDPError> rc = socket->setMaxPacingRate(bytesPerSecond);
+		if(!rc.has_value() || rc.value() == UDPError::OPERATION_NOT_SUPPORTED)
+			return true;
+		std::cerr << udp_error_to_string(rc.value()) << std::endl;
+		return false;
+	}
+
+	// Байт в очереди ожидания токенов
+	size_t pacingBacklog() const
+	{
+		size_t bytes = 0;
+		for(size_t i = pacedHead_; i < paced_.size(); ++i)
+			bytes += paced_[i].size;
+		return bytes;
+	}
+
+	uint64_t getPacing() const
+	{
+		return pacer_ ? pacer_->rate() : 0;
+	}
+
+	// Склейка мелких сообщений: sendData копит их в датаграмму до maxDatagramSize байт
+	// и отправляет, когда следующее не помещается или с первого прошло deadline.
+	// Срок проверяется при sendData/receiveData, в паузах нужно вызывать flush().
+	// Получатель отдаёт сообщения из склеенной датаграммы по одному.
+	void setCoalescing(bool enable, size_t maxDatagramSize = 1200,
+		std::chrono::microseconds deadline = std::chrono::microseconds(1000))
+	{
+		if(!enable)
+			flush();
+		coalescing_ = enable;
+		coalesceLimit_ = maxDatagramSize;
+		coalesceDeadline_ = deadline;
+		if(enable)
+			extendedHeader_ = true;
+	}
+
+	bool getCoalescing() const
+	{
+		return coalescing_;
+	}
+
+	// Отправляет накопленные сообщения; 0, если отправлять нечего
+	ssize_t flush();
+
+	// Нумерация сообщений. С dropStale приём отбрасывает сообщения не новее
+	// последнего принятого от того же узла (устаревшие и повторы), O(1) на пакет.
+	// Откат номера больше чем на 1024 считается перезапуском отправителя: приём
+	// продолжается с нового номера (sequenceStats().restarts).
+	void setSequencing(bool enable, bool dropStale = true)
+	{
+		sequencing_ = enable;
+		dropStale_ = dropStale;
+		if(enable)
+			extendedHeader_ = true;
+	}
+
+	bool getSequencing() const
+	{
+		return sequencing_;
+	}
+
+	SequenceStats sequenceStats() const
+	{
+		SequenceStats total;
+		peers_.forEach([&](const PeerSession& session) { total += session.sequence; });
+		return total;
+	}
+
+	SequenceStats sequenceStats(IPAddress peer) const
+	{
+		SequenceStats total;
+		peers_.forEach([&](const PeerSession& session)
+		{
+			if(session.endpoint.ip == peer)
+				total += session.sequence;
+		});
+		return total;
+	}
+
+	SequenceStats sequenceStats(const Endpoint& peer) const
+	{
+		const PeerSession* session = peers_.find(peer);
+		return session ? session->sequence : SequenceStats{};
+	}
+
+	// Синхронизация часов с узлами: раз в interval (проверяется в receiveData) всем узлам
+	// из peers() или, пока их нет, адресату по умолчанию уходит короткий служебный запрос,
+	// ответ на него даёт смещение часов узла (обмен как в NTP). Оценка смещения и дрейфа
+	// по обменам с наименьшим RTT — clockEstimate(peer). Отвечает любой передатчик
+	// в расширенном режиме, даже без setClockSync. Часы — steady_clock.
+	void setClockSync(bool enable, std::chrono::milliseconds interval = std::chrono::milliseconds(1000))
+	{
+		if(interval.count() <= 0)
+			throw std::invalid_argument("void UDPTransmitter::setClockSync(bool, std::chrono::milliseconds) interval must be positive");
+		clockSync_ = enable;
+		clockInterval_ = interval;
+		lastClockProbe_ = {};
+		if(enable)
+			extendedHeader_ = true;
+	}
+
+	bool getClockSync() const
+	{
+		return clockSync_;
+	}
+
+	// Отправляет запрос синхронизации сейчас, не дожидаясь интервала
+	ssize_t syncClocks();
+
+	// nullptr, если узла нет в таблице; оценка готова, когда valid()
+	const ClockEstimator* clockEstimate(const Endpoint& peer) const
+	{
+		const PeerSession* session = peers_.find(peer);
+		return session ? &session->clock : nullptr;
+	}
+
+	// Метка времени узла (его steady_clock) в наших часах; nullopt, пока оценки нет
+	std::optional<std::chrono::steady_clock::time_point> toLocalTime(const Endpoint& peer, std::chrono::steady_clock::time_point remote) const
+	{
+		const ClockEstimator* clock = clockEstimate(peer);
+		if(!clock || !clock->valid())
+			return std::nullopt;
+		return clock->toLocal(remote);
+	}
+
+	// Heartbeat: раз в interval узлам из peers(), адресату и резервным адресатам уходит
+	// служебный кадр. Узел, от которого missThreshold интервалов ничего не приходило
+	// (любые пакеты, не только heartbeat), считается недоступным: вызывается обработчик
+	// живости, а если это адресат по умолчанию — он переключается на резервный
+	// (setFailoverTargets) или на широковещание. Ответ исходного адресата возвращает его.
+	// Сроки проверяются в receiveData и poll() колесом таймеров с шагом 1 мс.
+	void setHeartbeat(bool enable, std::chrono::milliseconds interval = std::chrono::milliseconds(10), unsigned missThreshold = 3)
+	{
+		if(interval.count() <= 0 || missThreshold == 0)
+			throw std::invalid_argument("void UDPTransmitter::setHeartbeat(bool, std::chrono::milliseconds, unsigned) interval and missThreshold must be positive");
+		heartbeat_ = enable;
+		heartbeatInterval_ = interval;
+		livenessTimeout_ = interval * missThreshold;
+		lastHeartbeat_ = {};
+		if(enable)
+			extendedHeader_ = true;
+	}
+
+	bool getHeartbeat() const
+	{
+		return heartbeat_;
+	}
+
+	// Резервные адресаты по убыванию приоритета. Выбирается первый живой; если живых нет —
+	// широковещание (fallbackToBroadcast) или первый не признанный недоступным.
+	void setFailoverTargets(std::vector<IPAddress> targets, bool fallbackToBroadcast = true)
+	{
+		failoverTargets_ = std::move(targets);
+		failoverBroadcast_ = fallbackToBroadcast;
+	}
+
+	// handler(peer, alive) — узел стал доступен (первый пакет) или пропал. Вызывается
+	// из receiveData/poll; таблицу узлов в нём менять нельзя.
+	void setLivenessHandler(std::function<void(const Endpoint&, bool)> handler)
+	{
+		livenessHandler_ = std::move(handler);
+	}
+
+	bool isPeerAlive(const Endpoint& peer) const
+	{
+		const PeerSession* session = peers_.find(peer);
+		return session && session->alive;
+	}
+
+	// Сколько раз адресат переключался на резервный из-за потери связи
+	uint64_t failoverCount() const
+	{
+		return failovers_;
+	}
+
+	// Обслуживает таймеры (склейка, очередь ограничения скорости, синхронизация часов,
+	// heartbeat, сборка фрагментов) без приёма пакетов
+	void poll()
+	{
+		serviceTimers(std::chrono::steady_clock::now());
+	}
+
+	// Таблица узлов, от которых приходили пакеты (не больше capacity, при заполнении
+	// вытесняется дольше всех молчащий). Пересоздание очищает таблицу.
+	void setPeerCapacity(size_t capacity)
+	{
+		peers_ = PeerTable(capacity);
+	}
+
+	const PeerTable& peers() const
+	{
+		return peers_;
+	}
+
+	// Удаляет узлы, молчащие дольше timeout; возвращает их число
+	size_t evictIdlePeers(std::chrono::milliseconds timeout)
+	{
+		return peers_.evictIdle(timeout);
+	}
+
+	size_t fecRecoveredCount() const
+	{
+		return fecDecoder_ ? fecDecoder_->recoveredCount() : 0;
+	}
+
+	bool getExtendedHeader() const
+	{
+		return extendedHeader_;
+	}
+
+	bool isValid() { return true; } // This method is not necessary, it is needed for better compatibility with the original library.
+
+	// Возвращает число байт, ушедших в сеть, или -1 при ошибке. Со склейкой
+	// (setCoalescing) мелкое сообщение возвращает свой размер dataSize: оно попадает
+	// в буфер, и байты датаграммы с накопленными сообщениями возвращает flush().
+	ssize_t sendData(const uint8_t* data, size_t dataSize);
+
 	ssize_t sendData(const char* data)
 	{
 		size_t length = strlen(data);
@@ -125,36 +722,29 @@ public:
 		return sendData(data.data(), data.size());
 	}
 
-	ReceiveInfo receiveData(uint8_t* buffer, size_t maxSize)
+	// Отправка конкретному узлу (например, отправителю: info.remoteEndpoint()),
+	// target_ не меняется
+	ssize_t sendDataTo(const Endpoint& peer, const uint8_t* data, size_t dataSize);
+
+	template <size_t N>
+	ssize_t sendDataTo(const Endpoint& peer, const Message<N>& data)
 	{
-		std::variant<ReceiveInfo, UDPError> rc = sock().recieve(buffer, maxSize);
-		if(std::holds_alternative<UDPError>(rc))
-		{
-			std::cerr << udp_error_to_string(std::get<UDPError>(rc)) << std::endl;
-			return ReceiveInfo(0, std::nullopt);
-		}
-		if(std::get<ReceiveInfo>(rc).dataSize < magicString_.length())
-			return RECEIVE_NONE;
-		if(memcmp(magicString_.c_str(), buffer, magicString_.length()) != 0)
-			return RECEIVE_NONE;
-		std::optional<IPAddress> remoteIP = std::get<ReceiveInfo>(rc).remoteIP;
-		if(remoteIP.has_value())
-		{
-			if(target_ != remoteIP.value())
-			{
-				if(lockTargetIP_ && target_ != IP_BROADCAST)
-					return RECEIVE_NONE;
-				target_ = remoteIP.value();
-			}
+		return sendDataTo(peer, data.data(), data.size());
+	}
 
-		}
-		if(target_ == IP_ANY)
-			target_ = IP_BROADCAST;
-		size_t new_size = std::get<ReceiveInfo>(rc).dataSize - magicString_.length();
-		memmove(buffer, buffer + magicString_.length(), new_size);
-		return ReceiveInfo(new_size, remoteIP);
+	// Отправка всем узлам таблицы пачкой датаграмм; 0, если таблица пуста.
+	// С нумерацией или FEC у каждого узла свой поток (номера и FEC-блоки), и каждому
+	// уходит своя пачка; узел, которому отвечают sendDataTo, добавляется в таблицу.
+	ssize_t sendDataToAll(const uint8_t* data, size_t dataSize);
+
+	template <size_t N>
+	ssize_t sendDataToAll(const Message<N>& data)
+	{
+		return sendDataToAll(data.data(), data.size());
 	}
 
+	ReceiveInfo receiveData(uint8_t* buffer, size_t maxSize);
+
 	template <size_t N>
 	ReceiveInfo receiveData(Message<N>* buffer)
 	{
@@ -163,6 +753,20 @@ public:
 		return rc;
 	}
 
+	// Вычитывает всю очередь сокета и возвращает только самое свежее сообщение.
+	// С нумерацией свежесть определяется номером: сообщение узла, пришедшее позже,
+	// но с меньшим номером (при dropStale = false), не вытесняет более новое.
+	// Без нумерации — последнее пришедшее.
+	ReceiveInfo receiveLatest(uint8_t* buffer, size_t maxSize);
+
+	template <size_t N>
+	ReceiveInfo receiveLatest(Message<N>* buffer)
+	{
+		ReceiveInfo rc = receiveLatest(buffer->end(), buffer->space());
+		buffer->addSize(rc.dataSize);
+		return rc;
+	}
+
 	uint32_t getTargetIPHost() const
 	{
 		return target_.toHost();
@@ -0,0 +1,114 @@
+#if !defined XDP_TRANSPORT_H
+#define XDP_TRANSPORT_H
+
+// AF_XDP (Linux 5.9+). Собирается с опцией CMake EASYUDP_XDP, определяет EASYUDP_WITH_XDP.
+
+#include <inttypes.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <chrono>
+
+#include <udpsocket.h>
+
+struct xdp_ring_offset;
+
+enum class XdpMode : uint8_t
+{
+	GENERIC, // SKB: работает на любом интерфейсе, в том числе veth; данные копируются
+	NATIVE,  // в драйвере сетевой карты
+};
+
+struct XdpConfig
+{
+	std::string interfaceName;
+	uint32_t queue = 0;           // очередь приёма интерфейса
+	IPAddress ip = IPAddress(0, 0, 0, 0); // свой адрес; 0.0.0.0 — первый IPv4 интерфейса, приём на любой
+	uint16_t port = 0;            // host-endian, обязателен
+	std::string magic;            // если задана, в сокет попадают только датаграммы с ней (до 32 байт)
+	XdpMode mode = XdpMode::GENERIC;
+	bool zeroCopy = false;        // XDP_ZEROCOPY, только NATIVE и с поддержкой драйвера
+	uint32_t frameCount = 4096;   // кадров UMEM, половина на приём, половина на отправку
+	uint32_t frameSize = 2048;    // 2048 или 4096
+};
+
+// Транспорт в обход UDP-стека ядра: XDP-программа на интерфейсе перенаправляет в сокет
+// AF_XDP только IPv4/UDP на наш порт (и адрес, и magic-строку, если заданы), остальной
+// трафик (ARP, чужие порты, фрагменты IP) идёт в ядро как обычно. С заданным адресом
+// принимаются датаграммы на него и на широковещательные адреса. Кадры приёма и
+// отправки лежат в общей с ядром памяти UMEM; заголовки Ethernet/IPv4/UDP разбираются
+// и собираются здесь. MAC получателя берётся из принятых пакетов или таблицы соседей
+// ядра (/proc/net/arp). Датаграммы больше кадра не поддерживаются. Только IPv4.
+// Программа отсоединяется от интерфейса при разрушении транспорта. Нужны CAP_NET_ADMIN и CAP_BPF.
+class XdpTransport : public Transport
+{
+	struct Ring
+	{
+		uint32_t* producer = nullptr;
+		uint32_t* consumer = nullptr;
+		uint32_t* flags = nullptr;
+		void* descs = nullptr;
+		uint32_t mask = 0;
+		uint32_t size = 0;
+		uint32_t cached = 0; // кэш индекса другой стороны
+		void* map = nullptr;
+		size_t mapSize = 0;
+	};
+
+	XdpConfig config_;
+	int ifindex_ = 0;
+	int socket_ = -1;
+	int mapFd_ = -1;
+	int progFd_ = -1;
+	int linkFd_ = -1;
+	uint8_t* umem_ = nullptr;
+	size_t umemSize_ = 0;
+	Ring fill_;
+	Ring completion_;
+	Ring rx_;
+	Ring tx_;
+	std::vector<uint64_t> freeFrames_; // кадры для отправки
+	std::array<uint8_t, 6> mac_{};
+	uint32_t ip_ = 0; // big-endian
+	uint32_t broadcast_ = 0; // широковещательный адрес подсети, big-endian
+	uint16_t port_ = 0; // big-endian
+	uint16_t ipId_ = 0;
+	std::unordered_map<uint32_t, std::array<uint8_t, 6>> neighbours_; // IPv4 big-endian → MAC
+	std::unordered_map<uint32_t, std::chrono::steady_clock::time_point> unresolved_; // нет в ARP до срока
+	uint64_t rxDropped_ = 0;
+
+	void setup();
+	void release();
+	void mapRing(Ring& ring, const xdp_ring_offset& offsets, uint64_t pageOffset, size_t descSize);
+	int loadProgram();
+	void attachProgram();
+	bool resolve(uint32_t ip, uint8_t* mac);
+	void reclaim();
+	void kickTx();
+	std::variant<size_t, UDPError> send(const DatagramView* datagrams, const Endpoint* destinations, size_t count, IPAddress ip);
+
+public:
+	// При ошибке настройки — std::runtime_error с причиной
+	explicit XdpTransport(const XdpConfig& config);
+	~XdpTransport() override;
+
+	XdpTransport(const XdpTransport&) = delete;
+	XdpTransport& operator=(const XdpTransport&) = delete;
+
+	std::variant<size_t, UDPError> send_batch(const DatagramView* datagrams, size_t count, IPAddress ip) override;
+	std::variant<size_t, UDPError> send_batch(const DatagramView* datagrams, const Endpoint* destinations, size_t count) override;
+	std::variant<ReceiveInfo, UDPError> recieve(uint8_t* buf, size_t size) override;
+
+	uint16_t getBindPort() override { return config_.port; }
+	uint32_t getBindInterface() override { return ip_; }
+
+	// MAC для адреса без обращения к таблице ядра (шлюз, статические соседи)
+	void setNeighbour(IPAddress ip, const std::array<uint8_t, 6>& mac) { neighbours_[ip.toNet()] = mac; }
+	// Кадры, отброшенные при разборе (не IPv4/UDP, обрезанные)
+	uint64_t droppedCount() const { return rxDropped_; }
+	const XdpConfig& config() const { return config_; }
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include <addressFilter.h>
+
+#include <algorithm>
+
+AddressFilter::AddressFilter(FilterAction defaultAction) :
+defaultAction_(defaultAction)
+{}
+
+void AddressFilter::add(Subnet subnet, FilterAction action)
+{
+	rules_.push_back(Rule{ subnet, action });
+	dirty_ = true;
+}
+
+void AddressFilter::clear()
+{
+	rules_.clear();
+	dirty_ = true;
+}
+
+void AddressFilter::compile() const
+{
+	// Подсети CIDR либо вложены, либо не пересекаются, поэтому интервалы строятся
+	// одним проходом по правилам, отсортированным по началу и от широких к узким,
+	// со стеком объемлющих подсетей.
+	std::vector<Rule> rules = rules_;
+	std::stable_sort(rules.begin(), rules.end(), [](const Rule& a, const Rule& b)
+	{
+		if(a.subnet.firstHost() != b.subnet.firstHost())
+			return a.subnet.firstHost() < b.subnet.firstHost();
+		return a.subnet.prefix() < b.subnet.prefix();
+	});
+	// Из одинаковых подсетей остаётся добавленная последней
+	auto last = std::unique(rules.rbegin(), rules.rend(), [](const Rule& a, const Rule& b)
+	{
+		return a.subnet == b.subnet;
+	});
+	rules.erase(rules.begin(), last.base());
+
+	starts_.clear();
+	actions_.clear();
+	auto emit = [&](uint64_t start, FilterAction action)
+	{
+		if(start > UINT32_MAX)
+			return;
+		if(!starts_.empty() && starts_.back() == start)
+		{
+			actions_.back() = action;
+			if(actions_.size() >= 2 && actions_[actions_.size() - 2] == action)
+			{
+				starts_.pop_back();
+				actions_.pop_back();
+			}
+			return;
+		}
+		if(actions_.empty() || actions_.back() != action)
+		{
+			starts_.push_back(static_cast<uint32_t>(start));
+			actions_.push_back(action);
+		}
+	};
+
+	std::vector<const Rule*> stack;
+	auto closeUntil = [&](uint64_t position)
+	{
+		while(!stack.empty() && stack.back()->subnet.lastHost() < position)
+		{
+			uint64_t next = static_cast<uint64_t>(stack.back()->subnet.lastHost()) + 1;
+			stack.pop_back();
+			emit(next, stack.empty() ? defaultAction_ : stack.back()->action);
+		}
+	};
+
+	emit(0, defaultAction_);
+	for(const Rule& rule : rules)
+	{
+		closeUntil(rule.subnet.firstHost());
+		emit(rule.subnet.firstHost(), rule.action);
+		stack.push_back(&rule);
+	}
+	closeUntil(static_cast<uint64_t>(UINT32_MAX) + 1);
+	dirty_ = false;
+}
+
+FilterAction AddressFilter::check(IPAddress address) const
+{
+	if(dirty_)
+		compile();
+
+	// Последний интервал с началом не больше адреса; ветвление только по счётчику цикла
+	uint32_t key = address.toHost();
+	const uint32_t* base = starts_.data();
+	size_t count = starts_.size();
+	while(count > 1)
+	{
+		size_t half = count / 2;
+		base = base[half] <= key ? base + half : base;
+		count -= half;
+	}
+	return actions_[base - starts_.data()];
+}
+
+size_t AddressFilter::intervalCount() const
+{
+	if(dirty_)
+		compile();
+	return starts_.size();
+}
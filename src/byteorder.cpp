@@ -0,0 +1,201 @@
+#include <byteorder.h>
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BYTE_ORDER_X86_DISPATCH 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define BYTE_ORDER_NEON 1
+#include <arm_neon.h>
+#endif
+
+// ────────────────────────────────────────────────
+//  Скалярная реализация (хвосты и запасной вариант)
+// ────────────────────────────────────────────────
+
+namespace
+{
+	template<typename U>
+	U swapScalar(U val)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		if constexpr (sizeof(U) == 2)
+			return __builtin_bswap16(val);
+		else if constexpr (sizeof(U) == 4)
+			return __builtin_bswap32(val);
+		else
+			return __builtin_bswap64(val);
+#else
+		return reverseByteOrder(val);
+#endif
+	}
+
+	template<typename U>
+	void swapScalarRange(uint8_t* dst, const uint8_t* src, size_t count)
+	{
+		for(size_t i = 0; i < count; ++i)
+		{
+			U val;
+			memcpy(&val, src + i * sizeof(U), sizeof(U));
+			val = swapScalar(val);
+			memcpy(dst + i * sizeof(U), &val, sizeof(U));
+		}
+	}
+
+	void swapScalarBytes(uint8_t* dst, const uint8_t* src, size_t count, size_t elemSize)
+	{
+		switch(elemSize)
+		{
+			case 2: swapScalarRange<uint16_t>(dst, src, count); return;
+			case 4: swapScalarRange<uint32_t>(dst, src, count); return;
+			case 8: swapScalarRange<uint64_t>(dst, src, count); return;
+		}
+	}
+
+	using SwapKernel = void (*)(uint8_t*, const uint8_t*, size_t, size_t);
+
+#if defined(BYTE_ORDER_X86_DISPATCH)
+
+	// Маски pshufb: разворот байт внутри каждого элемента 16-байтного блока
+	alignas(16) constexpr uint8_t SHUFFLE_MASKS[3][16] = {
+		{ 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+		{ 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 },
+		{ 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 },
+	};
+
+	constexpr size_t maskIndex(size_t elemSize)
+	{
+		return elemSize == 2 ? 0 : elemSize == 4 ? 1 : 2;
+	}
+
+	__attribute__((target("ssse3")))
+	void swapSSSE3(uint8_t* dst, const uint8_t* src, size_t count, size_t elemSize)
+	{
+		const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(SHUFFLE_MASKS[maskIndex(elemSize)]));
+		size_t bytes = count * elemSize;
+		size_t i = 0;
+		for(; i + 64 <= bytes; i += 64)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 32));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 48));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),      _mm_shuffle_epi8(a, mask));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 16), _mm_shuffle_epi8(b, mask));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 32), _mm_shuffle_epi8(c, mask));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 48), _mm_shuffle_epi8(d, mask));
+		}
+		for(; i + 16 <= bytes; i += 16)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(a, mask));
+		}
+		swapScalarBytes(dst + i, src + i, (bytes - i) / elemSize, elemSize);
+	}
+
+	__attribute__((target("avx2")))
+	void swapAVX2(uint8_t* dst, const uint8_t* src, size_t count, size_t elemSize)
+	{
+		const __m128i half = _mm_load_si128(reinterpret_cast<const __m128i*>(SHUFFLE_MASKS[maskIndex(elemSize)]));
+		const __m256i mask = _mm256_broadcastsi128_si256(half);
+		size_t bytes = count * elemSize;
+		size_t i = 0;
+		for(; i + 128 <= bytes; i += 128)
+		{
+			__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32));
+			__m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 64));
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 96));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),      _mm256_shuffle_epi8(a, mask));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 32), _mm256_shuffle_epi8(b, mask));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 64), _mm256_shuffle_epi8(c, mask));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 96), _mm256_shuffle_epi8(d, mask));
+		}
+		for(; i + 32 <= bytes; i += 32)
+		{
+			__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(a, mask));
+		}
+		swapScalarBytes(dst + i, src + i, (bytes - i) / elemSize, elemSize);
+	}
+
+	SwapKernel selectKernel()
+	{
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2"))
+			return swapAVX2;
+		if(__builtin_cpu_supports("ssse3"))
+			return swapSSSE3;
+		return swapScalarBytes;
+	}
+
+#elif defined(BYTE_ORDER_NEON)
+
+	void swapNEON(uint8_t* dst, const uint8_t* src, size_t count, size_t elemSize)
+	{
+		size_t bytes = count * elemSize;
+		size_t i = 0;
+		for(; i + 16 <= bytes; i += 16)
+		{
+			uint8x16_t v = vld1q_u8(src + i);
+			if(elemSize == 2)
+				v = vrev16q_u8(v);
+			else if(elemSize == 4)
+				v = vrev32q_u8(v);
+			else
+				v = vrev64q_u8(v);
+			vst1q_u8(dst + i, v);
+		}
+		swapScalarBytes(dst + i, src + i, (bytes - i) / elemSize, elemSize);
+	}
+
+	SwapKernel selectKernel()
+	{
+		return swapNEON;
+	}
+
+#else
+
+	SwapKernel selectKernel()
+	{
+		return swapScalarBytes;
+	}
+
+#endif
+}
+
+void reverseByteOrderBulk(void* dst, const void* src, size_t count, size_t elemSize) noexcept
+{
+	static const SwapKernel kernel = selectKernel();
+
+	uint8_t* out = static_cast<uint8_t*>(dst);
+	const uint8_t* in = static_cast<const uint8_t*>(src);
+
+	switch(elemSize)
+	{
+		case 1:
+			if(out != in)
+				memcpy(out, in, count);
+			return;
+		case 2:
+		case 4:
+		case 8:
+			kernel(out, in, count, elemSize);
+			return;
+		default:
+			for(size_t i = 0; i < count; ++i) // редкие размеры (long double и т.п.)
+			{
+				uint8_t* o = out + i * elemSize;
+				const uint8_t* s = in + i * elemSize;
+				for(size_t j = 0; j < elemSize / 2; ++j)
+				{
+					uint8_t tmp = s[j];
+					o[j] = s[elemSize - 1 - j];
+					o[elemSize - 1 - j] = tmp;
+				}
+				if(elemSize % 2 && o != s)
+					o[elemSize / 2] = s[elemSize / 2];
+			}
+	}
+}
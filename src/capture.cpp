@@ -0,0 +1,367 @@
+#include <capture.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#include <byteorder.h>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace
+{
+	constexpr char FILE_MAGIC[8] = { 'E', 'U', 'D', 'P', 'C', 'A', 'P', '\0' };
+	constexpr uint32_t FILE_VERSION = 1;
+	constexpr size_t END_OFFSET = 16; // поле "конец данных" в заголовке
+
+	template <typename T>
+	void store(uint8_t* out, T value)
+	{
+		value = hton(value);
+		memcpy(out, &value, sizeof(T));
+	}
+
+	template <typename T>
+	T load(const uint8_t* in)
+	{
+		T value;
+		memcpy(&value, in, sizeof(T));
+		return ntoh(value);
+	}
+
+	size_t alignUp(size_t size)
+	{
+		return (size + 7) & ~size_t(7);
+	}
+
+	// Кусок кратен 64 КиБ: смещение отображения должно быть кратно странице (до 64 КиБ на ARM64)
+	constexpr size_t CHUNK_ALIGN = 64 * 1024;
+
+	size_t alignChunk(size_t size)
+	{
+		if(size < CHUNK_ALIGN)
+			return CHUNK_ALIGN;
+		if(size > SIZE_MAX - CHUNK_ALIGN)
+			return size & ~(CHUNK_ALIGN - 1);
+		return (size + CHUNK_ALIGN - 1) & ~(CHUNK_ALIGN - 1);
+	}
+}
+
+// ────────────────────────────────────────────────
+//  CaptureWriter
+// ────────────────────────────────────────────────
+
+CaptureWriter::CaptureWriter(const std::string& path, size_t chunkSize, size_t maxFileSize) :
+path_(path), chunkSize_(alignChunk(chunkSize))
+{
+#ifdef _WIN32
+	(void)maxFileSize;
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("CaptureWriter::CaptureWriter(const std::string&, size_t, size_t) cannot create " + path);
+	file_ = reinterpret_cast<intptr_t>(file);
+#else
+	int file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(file < 0)
+		throw std::runtime_error("CaptureWriter::CaptureWriter(const std::string&, size_t, size_t) cannot create " + path);
+	file_ = file;
+	reserved_ = std::max(alignChunk(maxFileSize), chunkSize_);
+#endif
+	if(!map(chunkSize_))
+	{
+		close();
+		throw std::runtime_error("CaptureWriter::CaptureWriter(const std::string&, size_t, size_t) cannot map " + path);
+	}
+	memcpy(data_, FILE_MAGIC, sizeof(FILE_MAGIC));
+	store<uint32_t>(data_ + 8, FILE_VERSION);
+	store<uint32_t>(data_ + 12, HEADER_SIZE);
+	end_ = HEADER_SIZE;
+	store<uint64_t>(data_ + END_OFFSET, end_);
+#ifndef _WIN32
+	grower_ = std::thread([this] { growLoop(); });
+#endif
+}
+
+CaptureWriter::~CaptureWriter()
+{
+	close();
+}
+
+bool CaptureWriter::map(size_t size)
+{
+#ifdef _WIN32
+	unmap();
+	HANDLE file = reinterpret_cast<HANDLE>(file_);
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), nullptr);
+	if(!mapping)
+		return false;
+	void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+	if(!view)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+	mapping_ = reinterpret_cast<intptr_t>(mapping);
+	data_ = static_cast<uint8_t*>(view);
+	mapped_.store(size, std::memory_order_release);
+	return true;
+#else
+	// Резерв без доступа и без памяти; куски файла отображаются поверх него
+	void* reserve = mmap(nullptr, reserved_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(reserve == MAP_FAILED)
+		return false;
+	data_ = static_cast<uint8_t*>(reserve);
+	std::lock_guard<std::mutex> lock(growMutex_);
+	return extend(size);
+#endif
+}
+
+void CaptureWriter::unmap()
+{
+	if(!data_)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(data_);
+	CloseHandle(reinterpret_cast<HANDLE>(mapping_));
+	mapping_ = 0;
+#else
+	munmap(data_, reserved_);
+#endif
+	data_ = nullptr;
+	mapped_.store(0, std::memory_order_relaxed);
+}
+
+bool CaptureWriter::extend(size_t required)
+{
+	size_t mapped = mapped_.load(std::memory_order_relaxed);
+	if(mapped >= required)
+		return true;
+	size_t size = mapped;
+	while(size < required)
+		size += chunkSize_;
+#ifdef _WIN32
+	return map(size);
+#else
+	if(size > reserved_)
+		return false;
+	if(ftruncate(static_cast<int>(file_), static_cast<off_t>(size)) != 0)
+		return false;
+	// Новый кусок ложится сразу за отображённым, адреса записанных данных не меняются
+	void* view = mmap(data_ + mapped, size - mapped, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+		static_cast<int>(file_), static_cast<off_t>(mapped));
+	if(view == MAP_FAILED)
+		return false;
+	mapped_.store(size, std::memory_order_release);
+	return true;
+#endif
+}
+
+bool CaptureWriter::growNow(size_t required)
+{
+	++stalls_;
+#ifdef _WIN32
+	return extend(required);
+#else
+	std::lock_guard<std::mutex> lock(growMutex_); // фоновый рост мог уже начаться
+	return extend(required);
+#endif
+}
+
+void CaptureWriter::requestGrowth()
+{
+	{
+		std::lock_guard<std::mutex> lock(growMutex_);
+		growPending_.store(true, std::memory_order_relaxed);
+	}
+	growWake_.notify_one();
+}
+
+void CaptureWriter::growLoop()
+{
+	std::unique_lock<std::mutex> lock(growMutex_);
+	for(;;)
+	{
+		growWake_.wait(lock, [this] { return stopping_ || growPending_.load(std::memory_order_relaxed); });
+		if(stopping_)
+			return;
+		// Неудача (конец резерва, нет места на диске) проявится в write через growNow
+		extend(mapped_.load(std::memory_order_relaxed) + chunkSize_);
+		growPending_.store(false, std::memory_order_relaxed);
+	}
+}
+
+bool CaptureWriter::write(const Endpoint& peer, const uint8_t* data, size_t size, std::chrono::system_clock::time_point timestamp)
+{
+	if(!data_ || size > UINT32_MAX)
+		return false;
+	size_t recordSize = alignUp(RECORD_HEADER_SIZE + size);
+	size_t mapped = mapped_.load(std::memory_order_acquire);
+	if(end_ + recordSize > mapped)
+	{
+		if(!growNow(end_ + recordSize))
+			return false;
+		mapped = mapped_.load(std::memory_order_acquire);
+	}
+
+	uint8_t* out = data_ + end_;
+	store<uint32_t>(out, static_cast<uint32_t>(size));
+	store<uint16_t>(out + 4, peer.port);
+	store<uint16_t>(out + 6, 0);
+	store<uint64_t>(out + 8, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count()));
+	memcpy(out + 16, peer.ip.bytes().data(), 16);
+	memcpy(out + RECORD_HEADER_SIZE, data, size);
+	memset(out + RECORD_HEADER_SIZE + size, 0, recordSize - RECORD_HEADER_SIZE - size);
+
+	end_ += recordSize;
+	store<uint64_t>(data_ + END_OFFSET, end_); // запись видна читателю только целиком
+	++records_;
+#ifndef _WIN32
+	// Пройдена половина последнего куска: следующий готовит фоновый поток
+	if(mapped - end_ < chunkSize_ / 2 && !growPending_.load(std::memory_order_relaxed))
+		requestGrowth();
+#endif
+	return true;
+}
+
+void CaptureWriter::close()
+{
+	if(grower_.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(growMutex_);
+			stopping_ = true;
+		}
+		growWake_.notify_one();
+		grower_.join();
+	}
+	unmap();
+	if(file_ == -1)
+		return;
+#ifdef _WIN32
+	HANDLE file = reinterpret_cast<HANDLE>(file_);
+	LARGE_INTEGER position;
+	position.QuadPart = static_cast<LONGLONG>(end_);
+	if(end_ > 0 && SetFilePointerEx(file, position, nullptr, FILE_BEGIN))
+		SetEndOfFile(file);
+	CloseHandle(file);
+#else
+	if(end_ > 0 && ftruncate(static_cast<int>(file_), static_cast<off_t>(end_)) != 0)
+		end_ = 0; // файл остаётся с хвостом из нулей, читатель остановится по "концу данных"
+	::close(static_cast<int>(file_));
+#endif
+	file_ = -1;
+}
+
+// ────────────────────────────────────────────────
+//  CaptureReader
+// ────────────────────────────────────────────────
+
+CaptureReader::CaptureReader(const std::string& path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("CaptureReader::CaptureReader(const std::string&) cannot open " + path);
+	file_ = reinterpret_cast<intptr_t>(file);
+	LARGE_INTEGER fileSize;
+	if(GetFileSizeEx(file, &fileSize))
+		size_ = static_cast<size_t>(fileSize.QuadPart);
+	if(size_ >= CaptureWriter::HEADER_SIZE)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(mapping)
+		{
+			mapping_ = reinterpret_cast<intptr_t>(mapping);
+			data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+	}
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if(file < 0)
+		throw std::runtime_error("CaptureReader::CaptureReader(const std::string&) cannot open " + path);
+	file_ = file;
+	struct stat info;
+	if(fstat(file, &info) == 0)
+		size_ = static_cast<size_t>(info.st_size);
+	if(size_ >= CaptureWriter::HEADER_SIZE)
+	{
+		void* view = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file, 0);
+		if(view != MAP_FAILED)
+			data_ = static_cast<const uint8_t*>(view);
+	}
+#endif
+	if(!data_ || memcmp(data_, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || load<uint32_t>(data_ + 8) != FILE_VERSION)
+	{
+		release();
+		throw std::runtime_error("CaptureReader::CaptureReader(const std::string&) not a capture file: " + path);
+	}
+	uint64_t end = load<uint64_t>(data_ + END_OFFSET);
+	end_ = end < size_ ? static_cast<size_t>(end) : size_;
+	offset_ = load<uint32_t>(data_ + 12);
+}
+
+CaptureReader::~CaptureReader()
+{
+	release();
+}
+
+void CaptureReader::release()
+{
+#ifdef _WIN32
+	if(data_)
+		UnmapViewOfFile(data_);
+	if(mapping_)
+		CloseHandle(reinterpret_cast<HANDLE>(mapping_));
+	if(file_ != -1)
+		CloseHandle(reinterpret_cast<HANDLE>(file_));
+#else
+	if(data_)
+		munmap(const_cast<uint8_t*>(data_), size_);
+	if(file_ != -1)
+		::close(static_cast<int>(file_));
+#endif
+	data_ = nullptr;
+	mapping_ = 0;
+	file_ = -1;
+}
+
+std::optional<CaptureRecord> CaptureReader::next()
+{
+	if(offset_ + CaptureWriter::RECORD_HEADER_SIZE > end_)
+		return std::nullopt;
+	const uint8_t* in = data_ + offset_;
+	size_t size = load<uint32_t>(in);
+	size_t recordSize = alignUp(CaptureWriter::RECORD_HEADER_SIZE + size);
+	if(recordSize > end_ - offset_)
+		return std::nullopt;
+
+	std::array<uint8_t, 16> address;
+	memcpy(address.data(), in + 16, 16);
+	CaptureRecord record{
+		std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+			std::chrono::nanoseconds(load<uint64_t>(in + 8)))),
+		Endpoint{ NetAddress(address), load<uint16_t>(in + 4) },
+		in + CaptureWriter::RECORD_HEADER_SIZE,
+		size
+	};
+	offset_ += recordSize;
+	return record;
+}
+
+std::optional<std::chrono::system_clock::time_point> CaptureReader::peekTimestamp() const
+{
+	if(offset_ + CaptureWriter::RECORD_HEADER_SIZE > end_)
+		return std::nullopt;
+	return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+		std::chrono::nanoseconds(load<uint64_t>(data_ + offset_ + 8))));
+}
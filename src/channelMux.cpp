@@ -0,0 +1,181 @@
+#include <channelMux.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	constexpr size_t MAX_DATAGRAM_SIZE = 65536;
+	constexpr unsigned SEEDS_PER_SIZE = 256; // попыток подобрать seed до увеличения таблицы
+
+	uint64_t prefixHash(const uint8_t* data, size_t length, uint64_t seed) noexcept
+	{
+		uint64_t h = seed ^ (length * 0x9E3779B97F4A7C15ull);
+		while(length >= 8)
+		{
+			uint64_t word;
+			memcpy(&word, data, 8);
+			h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+			h ^= h >> 32;
+			data += 8;
+			length -= 8;
+		}
+		uint64_t tail = 0;
+		if(length > 0)
+			memcpy(&tail, data, length);
+		h = (h ^ tail) * 0xC4CEB9FE1A85EC53ull;
+		return h ^ (h >> 29);
+	}
+}
+
+ChannelMux::ChannelMux(uint16_t port) : sock_(std::make_unique<UDPSocket>(hton(port)))
+{}
+
+ChannelMux::ChannelMux(UDPSocket* sock) : sock_(sock)
+{}
+
+size_t ChannelMux::addChannel(std::string magic, Handler handler)
+{
+	if(magic.empty())
+		throw std::invalid_argument("ChannelMux::addChannel(std::string, Handler) magic must not be empty");
+	for(const Channel& channel : channels_)
+		if(channel.magic == magic)
+			throw std::invalid_argument("ChannelMux::addChannel(std::string, Handler) magic \"" + magic + "\" is already registered");
+	channels_.push_back(Channel{ std::move(magic), std::move(handler) });
+	rebuild();
+	return channels_.size() - 1;
+}
+
+size_t ChannelMux::addSnapshotChannel(std::string magic, SnapshotStore& store)
+{
+	uint32_t channel = static_cast<uint32_t>(channels_.size());
+	return addChannel(std::move(magic), [&store, channel](const uint8_t* data, size_t size, const ReceiveInfo& info)
+	{
+		store.publish(info.remoteEndpoint(), channel, data, size);
+	});
+}
+
+void ChannelMux::rebuild()
+{
+	std::vector<size_t> lengths;
+	for(const Channel& channel : channels_)
+		lengths.push_back(channel.magic.length());
+	std::sort(lengths.begin(), lengths.end(), std::greater<size_t>());
+	lengths.erase(std::unique(lengths.begin(), lengths.end()), lengths.end());
+
+	groups_.clear();
+	for(size_t length : lengths)
+	{
+		std::vector<int32_t> members;
+		for(size_t i = 0; i < channels_.size(); ++i)
+			if(channels_[i].magic.length() == length)
+				members.push_back(static_cast<int32_t>(i));
+
+		// Подбираем seed, при котором у строк этой длины нет коллизий
+		unsigned bits = 1;
+		while((size_t(1) << bits) < members.size() * 2)
+			++bits;
+		LengthGroup group{ length, 0, 64 - bits, {} };
+		for(uint64_t attempt = 1;; ++attempt)
+		{
+			if(attempt % SEEDS_PER_SIZE == 0)
+			{
+				++bits;
+				group.shift = 64 - bits;
+			}
+			group.seed = attempt;
+			group.slots.assign(size_t(1) << bits, -1);
+			bool collision = false;
+			for(int32_t member : members)
+			{
+				const uint8_t* magic = reinterpret_cast<const uint8_t*>(channels_[member].magic.data());
+				int32_t& slot = group.slots[prefixHash(magic, length, group.seed) >> group.shift];
+				if(slot >= 0)
+				{
+					collision = true;
+					break;
+				}
+				slot = member;
+			}
+			if(!collision)
+				break;
+		}
+		groups_.push_back(std::move(group));
+	}
+}
+
+int32_t ChannelMux::lookup(const uint8_t* data, size_t size) const
+{
+	for(const LengthGroup& group : groups_)
+	{
+		if(size < group.length)
+			continue;
+		int32_t channel = group.slots[prefixHash(data, group.length, group.seed) >> group.shift];
+		if(channel >= 0 && memcmp(channels_[channel].magic.data(), data, group.length) == 0)
+			return channel;
+	}
+	return -1;
+}
+
+size_t ChannelMux::poll(size_t maxPackets)
+{
+	if(recvBuf_.size() < MAX_DATAGRAM_SIZE)
+		recvBuf_.resize(MAX_DATAGRAM_SIZE);
+
+	size_t dispatched = 0;
+	for(size_t i = 0; i < maxPackets; ++i)
+	{
+		std::variant<ReceiveInfo, UDPError> rc = sock().recieve(recvBuf_.data(), recvBuf_.size());
+		if(std::holds_alternative<UDPError>(rc))
+		{
+			std::cerr << udp_error_to_string(std::get<UDPError>(rc)) << std::endl;
+			break;
+		}
+		ReceiveInfo info = std::get<ReceiveInfo>(rc);
+		if(!recieved(info))
+		{
+			if(wouldBlock(info))
+				break;
+			continue; // отфильтрована транспортом, очередь ещё не пуста
+		}
+
+		int32_t index = lookup(recvBuf_.data(), info.dataSize);
+		if(index < 0)
+		{
+			++unmatched_;
+			continue;
+		}
+		Channel& channel = channels_[index];
+		size_t magicSize = channel.magic.length();
+		++channel.received;
+		++dispatched;
+		if(channel.handler)
+			channel.handler(recvBuf_.data() + magicSize, info.dataSize - magicSize,
+				info.withSize(info.dataSize - magicSize));
+	}
+	return dispatched;
+}
+
+ssize_t ChannelMux::sendResult(std::variant<size_t, UDPError> rc, size_t size)
+{
+	if(std::holds_alternative<UDPError>(rc))
+	{
+		std::cerr << udp_error_to_string(std::get<UDPError>(rc)) << std::endl;
+		return -1;
+	}
+	return std::get<size_t>(rc) == 1 ? static_cast<ssize_t>(size) : -1;
+}
+
+ssize_t ChannelMux::send(size_t channel, const uint8_t* data, size_t size, IPAddress ip)
+{
+	const std::string& magic = channels_.at(channel).magic;
+	DatagramView datagram{ reinterpret_cast<const uint8_t*>(magic.data()), magic.length(), data, size };
+	return sendResult(sock().send_batch(&datagram, 1, ip), magic.length() + size);
+}
+
+ssize_t ChannelMux::send(size_t channel, const uint8_t* data, size_t size, const Endpoint& peer)
+{
+	const std::string& magic = channels_.at(channel).magic;
+	DatagramView datagram{ reinterpret_cast<const uint8_t*>(magic.data()), magic.length(), data, size };
+	return sendResult(sock().send_batch(&datagram, &peer, 1), magic.length() + size);
+}
@@ -0,0 +1,115 @@
+#include <clockSync.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	int64_t toNs(ClockEstimator::Clock::time_point time)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+	}
+
+	ClockEstimator::Clock::time_point fromNs(int64_t ns)
+	{
+		return ClockEstimator::Clock::time_point(std::chrono::duration_cast<ClockEstimator::Clock::duration>(std::chrono::nanoseconds(ns)));
+	}
+}
+
+bool ClockEstimator::addSample(Clock::time_point t1, Clock::time_point t2, Clock::time_point t3, Clock::time_point t4)
+{
+	int64_t n1 = toNs(t1);
+	int64_t n2 = toNs(t2);
+	int64_t n3 = toNs(t3);
+	int64_t n4 = toNs(t4);
+	int64_t rtt = (n4 - n1) - (n3 - n2);
+	if(n4 < n1 || n3 < n2 || rtt < 0)
+	{
+		++rejected_;
+		return false;
+	}
+	++samples_;
+
+	// Разности считаются до сложения: эпохи часов узлов могут различаться на годы
+	Sample sample{ n1 + (n4 - n1) / 2, ((n2 - n1) + (n3 - n4)) / 2, rtt };
+	window_[windowNext_] = sample;
+	windowNext_ = (windowNext_ + 1) % WINDOW;
+	if(windowCount_ < WINDOW)
+		++windowCount_;
+
+	const Sample* best = &window_[0];
+	for(size_t i = 1; i < windowCount_; ++i)
+		if(window_[i].rtt < best->rtt)
+			best = &window_[i];
+
+	// Одна и та же лучшая выборка попадает в историю один раз
+	if(best->local > lastSelected_)
+	{
+		lastSelected_ = best->local;
+		history_[historyNext_] = *best;
+		historyNext_ = (historyNext_ + 1) % HISTORY;
+		if(historyCount_ < HISTORY)
+			++historyCount_;
+		fit();
+	}
+	rtt_ = best->rtt;
+	return true;
+}
+
+void ClockEstimator::fit()
+{
+	// Координаты относительно последней выборки, чтобы не терять точность double
+	const Sample& last = history_[(historyNext_ + HISTORY - 1) % HISTORY];
+	reference_ = last.local;
+	if(historyCount_ < MIN_DRIFT_SAMPLES) // по двум-трём точкам дрейф — в основном шум очередей
+	{
+		offset_ = static_cast<double>(last.offset);
+		drift_ = 0;
+		return;
+	}
+
+	// Взвешенные наименьшие квадраты: погрешность выборки не больше rtt / 2, вес — 1 / rtt²
+	double weights[HISTORY];
+	double total = 0;
+	double meanX = 0;
+	double meanY = 0;
+	for(size_t i = 0; i < historyCount_; ++i)
+	{
+		double bound = static_cast<double>(std::max<int64_t>(history_[i].rtt, 1000));
+		weights[i] = 1 / (bound * bound);
+		total += weights[i];
+		meanX += weights[i] * static_cast<double>(history_[i].local - reference_);
+		meanY += weights[i] * static_cast<double>(history_[i].offset - last.offset);
+	}
+	meanX /= total;
+	meanY /= total;
+
+	double sxx = 0;
+	double sxy = 0;
+	for(size_t i = 0; i < historyCount_; ++i)
+	{
+		double x = static_cast<double>(history_[i].local - reference_) - meanX;
+		double y = static_cast<double>(history_[i].offset - last.offset) - meanY;
+		sxx += weights[i] * x * x;
+		sxy += weights[i] * x * y;
+	}
+	drift_ = sxx > 0 ? std::clamp(sxy / sxx, -MAX_DRIFT, MAX_DRIFT) : 0;
+	offset_ = static_cast<double>(last.offset) + meanY - drift_ * meanX;
+}
+
+std::chrono::nanoseconds ClockEstimator::offset(Clock::time_point local) const
+{
+	return std::chrono::nanoseconds(std::llround(offset_ + drift_ * static_cast<double>(toNs(local) - reference_)));
+}
+
+ClockEstimator::Clock::time_point ClockEstimator::toLocal(Clock::time_point remote) const
+{
+	// remote = local + offset(local); смещение почти не меняется, хватает одной итерации
+	int64_t guess = toNs(remote) - std::llround(offset_);
+	return fromNs(toNs(remote) - offset(fromNs(guess)).count());
+}
+
+ClockEstimator::Clock::time_point ClockEstimator::toRemote(Clock::time_point local) const
+{
+	return local + std::chrono::duration_cast<Clock::duration>(offset(local));
+}
@@ -0,0 +1,191 @@
+#include <compression.h>
+
+#include <cstring>
+
+namespace
+{
+	constexpr size_t MIN_MATCH = 4;
+	constexpr size_t LAST_LITERALS = 5;   // последние 5 байт всегда литералы
+	constexpr size_t MF_LIMIT = 12;       // последнее совпадение начинается не ближе 12 байт к концу
+	constexpr size_t MAX_OFFSET = 65535;
+	constexpr unsigned MAX_HASH_LOG = 12;
+
+	uint32_t read32(const uint8_t* p) noexcept
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	uint32_t hash32(uint32_t v, unsigned hashLog) noexcept
+	{
+		return (v * 2654435761u) >> (32 - hashLog);
+	}
+
+	// Записывает длину в формате LZ4 (продолжение байтами 255). false — не хватило места.
+	bool writeLength(uint8_t*& op, const uint8_t* opEnd, size_t len) noexcept
+	{
+		while(len >= 255)
+		{
+			if(op >= opEnd)
+				return false;
+			*op++ = 255;
+			len -= 255;
+		}
+		if(op >= opEnd)
+			return false;
+		*op++ = static_cast<uint8_t>(len);
+		return true;
+	}
+
+	bool readLength(const uint8_t*& ip, const uint8_t* ipEnd, size_t& len) noexcept
+	{
+		uint8_t b;
+		do
+		{
+			if(ip >= ipEnd)
+				return false;
+			b = *ip++;
+			len += b;
+		} while(b == 255);
+		return true;
+	}
+
+	bool emitSequence(uint8_t*& op, const uint8_t* opEnd, const uint8_t* literals, size_t literalLen, size_t offset, size_t matchLen) noexcept
+	{
+		if(op >= opEnd)
+			return false;
+		uint8_t* token = op++;
+		size_t litCode = literalLen < 15 ? literalLen : 15;
+		if(literalLen >= 15 && !writeLength(op, opEnd, literalLen - 15))
+			return false;
+		if(static_cast<size_t>(opEnd - op) < literalLen)
+			return false;
+		if(literalLen > 0)
+			memcpy(op, literals, literalLen);
+		op += literalLen;
+
+		if(matchLen == 0) // последняя последовательность, только литералы
+		{
+			*token = static_cast<uint8_t>(litCode << 4);
+			return true;
+		}
+
+		if(opEnd - op < 2)
+			return false;
+		*op++ = static_cast<uint8_t>(offset);
+		*op++ = static_cast<uint8_t>(offset >> 8);
+
+		size_t matchCode = matchLen - MIN_MATCH;
+		if(matchCode >= 15 && !writeLength(op, opEnd, matchCode - 15))
+			return false;
+		*token = static_cast<uint8_t>(litCode << 4 | (matchCode < 15 ? matchCode : 15));
+		return true;
+	}
+}
+
+size_t lzCompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity) noexcept
+{
+	uint8_t* op = dst;
+	const uint8_t* opEnd = dst + dstCapacity;
+	size_t anchor = 0;
+
+	if(srcSize > MF_LIMIT)
+	{
+		unsigned hashLog = 8;
+		while(hashLog < MAX_HASH_LOG && (size_t(1) << hashLog) < srcSize)
+			++hashLog;
+
+		uint32_t table[size_t(1) << MAX_HASH_LOG]; // позиция + 1, 0 — пусто
+		memset(table, 0, sizeof(uint32_t) << hashLog);
+
+		const size_t matchLimit = srcSize - LAST_LITERALS;
+		const size_t ipLimit = srcSize - MF_LIMIT;
+		size_t ip = 0;
+		while(ip < ipLimit)
+		{
+			uint32_t seq = read32(src + ip);
+			uint32_t h = hash32(seq, hashLog);
+			size_t ref = table[h];
+			table[h] = static_cast<uint32_t>(ip + 1);
+
+			if(ref == 0 || ip - (ref - 1) > MAX_OFFSET || read32(src + ref - 1) != seq)
+			{
+				ip += 1 + ((ip - anchor) >> 6); // ускоряемся на несжимаемых участках
+				continue;
+			}
+			--ref;
+
+			while(ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) // продлеваем совпадение назад
+			{
+				--ip;
+				--ref;
+			}
+
+			size_t len = MIN_MATCH;
+			while(ip + len < matchLimit && src[ip + len] == src[ref + len])
+				++len;
+
+			if(!emitSequence(op, opEnd, src + anchor, ip - anchor, ip - ref, len))
+				return 0;
+
+			ip += len;
+			anchor = ip;
+			if(ip - 2 < ipLimit)
+				table[hash32(read32(src + ip - 2), hashLog)] = static_cast<uint32_t>(ip - 2 + 1);
+		}
+	}
+
+	if(!emitSequence(op, opEnd, src + anchor, srcSize - anchor, 0, 0))
+		return 0;
+	return static_cast<size_t>(op - dst);
+}
+
+std::optional<size_t> lzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity) noexcept
+{
+	const uint8_t* ip = src;
+	const uint8_t* ipEnd = src + srcSize;
+	uint8_t* op = dst;
+	uint8_t* opEnd = dst + dstCapacity;
+
+	while(ip < ipEnd)
+	{
+		uint8_t token = *ip++;
+
+		size_t literalLen = token >> 4;
+		if(literalLen == 15 && !readLength(ip, ipEnd, literalLen))
+			return std::nullopt;
+		if(static_cast<size_t>(ipEnd - ip) < literalLen || static_cast<size_t>(opEnd - op) < literalLen)
+			return std::nullopt;
+		if(literalLen > 0)
+			memcpy(op, ip, literalLen);
+		ip += literalLen;
+		op += literalLen;
+
+		if(ip == ipEnd) // последняя последовательность
+			break;
+
+		if(ipEnd - ip < 2)
+			return std::nullopt;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(offset == 0 || offset > static_cast<size_t>(op - dst))
+			return std::nullopt;
+
+		size_t matchLen = token & 15;
+		if(matchLen == 15 && !readLength(ip, ipEnd, matchLen))
+			return std::nullopt;
+		matchLen += MIN_MATCH;
+		if(static_cast<size_t>(opEnd - op) < matchLen)
+			return std::nullopt;
+
+		const uint8_t* match = op - offset;
+		if(offset >= matchLen)
+			memcpy(op, match, matchLen);
+		else
+			for(size_t i = 0; i < matchLen; ++i) // перекрывающееся копирование (повторы)
+				op[i] = match[i];
+		op += matchLen;
+	}
+	return static_cast<size_t>(op - dst);
+}
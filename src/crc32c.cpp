@@ -0,0 +1,133 @@
+#include <crc32c.h>
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_X86_DISPATCH 1
+#include <immintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+namespace
+{
+	constexpr uint32_t POLYNOMIAL = 0x82F63B78; // отражённый 0x1EDC6F41
+
+	using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+	constexpr Tables makeTables()
+	{
+		Tables tables{};
+		for(uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t crc = i;
+			for(int bit = 0; bit < 8; ++bit)
+				crc = (crc >> 1) ^ (POLYNOMIAL & (0u - (crc & 1)));
+			tables[0][i] = crc;
+		}
+		for(uint32_t i = 0; i < 256; ++i)
+			for(size_t t = 1; t < 8; ++t)
+				tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+		return tables;
+	}
+
+	constexpr Tables TABLES = makeTables();
+
+	uint32_t crcSlicing8(uint32_t crc, const uint8_t* data, size_t size) noexcept
+	{
+		if constexpr (std::endian::native == std::endian::little)
+		{
+			while(size >= 8)
+			{
+				uint32_t lo;
+				uint32_t hi;
+				memcpy(&lo, data, 4);
+				memcpy(&hi, data + 4, 4);
+				lo ^= crc;
+				crc = TABLES[7][lo & 0xFF] ^ TABLES[6][(lo >> 8) & 0xFF] ^
+					TABLES[5][(lo >> 16) & 0xFF] ^ TABLES[4][lo >> 24] ^
+					TABLES[3][hi & 0xFF] ^ TABLES[2][(hi >> 8) & 0xFF] ^
+					TABLES[1][(hi >> 16) & 0xFF] ^ TABLES[0][hi >> 24];
+				data += 8;
+				size -= 8;
+			}
+		}
+		for(size_t i = 0; i < size; ++i)
+			crc = (crc >> 8) ^ TABLES[0][(crc ^ data[i]) & 0xFF];
+		return crc;
+	}
+
+	using CrcKernel = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+#if defined(CRC32C_X86_DISPATCH)
+
+	__attribute__((target("sse4.2")))
+	uint32_t crcSSE42(uint32_t crc, const uint8_t* data, size_t size) noexcept
+	{
+#if defined(__x86_64__)
+		uint64_t crc64 = crc;
+		for(; size >= 8; data += 8, size -= 8)
+		{
+			uint64_t word;
+			memcpy(&word, data, 8);
+			crc64 = _mm_crc32_u64(crc64, word);
+		}
+		crc = static_cast<uint32_t>(crc64);
+#endif
+		for(; size >= 4; data += 4, size -= 4)
+		{
+			uint32_t word;
+			memcpy(&word, data, 4);
+			crc = _mm_crc32_u32(crc, word);
+		}
+		for(; size > 0; ++data, --size)
+			crc = _mm_crc32_u8(crc, *data);
+		return crc;
+	}
+
+	CrcKernel selectKernel()
+	{
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("sse4.2"))
+			return crcSSE42;
+		return crcSlicing8;
+	}
+
+#elif defined(CRC32C_ARM)
+
+	uint32_t crcARM(uint32_t crc, const uint8_t* data, size_t size) noexcept
+	{
+		for(; size >= 8; data += 8, size -= 8)
+		{
+			uint64_t word;
+			memcpy(&word, data, 8);
+			crc = __crc32cd(crc, word);
+		}
+		for(; size > 0; ++data, --size)
+			crc = __crc32cb(crc, *data);
+		return crc;
+	}
+
+	CrcKernel selectKernel()
+	{
+		return crcARM;
+	}
+
+#else
+
+	CrcKernel selectKernel()
+	{
+		return crcSlicing8;
+	}
+
+#endif
+}
+
+uint32_t crc32c(const uint8_t* data, size_t size, uint32_t crc) noexcept
+{
+	static const CrcKernel kernel = selectKernel();
+	return ~kernel(~crc, data, size);
+}
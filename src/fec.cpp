@@ -0,0 +1,423 @@
+#include <fec.h>
+
+#include <cstring>
+#include <array>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define FEC_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+// ────────────────────────────────────────────────
+//  Таблицы GF(2^8)
+// ────────────────────────────────────────────────
+
+namespace
+{
+	struct GFTables
+	{
+		uint8_t exp[512];
+		uint8_t log[256];
+		uint8_t mul[256][256];
+		uint8_t mulLow[256][16];  // coef * x для x < 16
+		uint8_t mulHigh[256][16]; // coef * (x << 4)
+
+		GFTables()
+		{
+			unsigned x = 1;
+			for(unsigned i = 0; i < 255; ++i)
+			{
+				exp[i] = static_cast<uint8_t>(x);
+				log[x] = static_cast<uint8_t>(i);
+				x <<= 1;
+				if(x & 0x100)
+					x ^= 0x11D;
+			}
+			for(unsigned i = 255; i < 512; ++i)
+				exp[i] = exp[i - 255];
+			log[0] = 0;
+
+			for(unsigned a = 0; a < 256; ++a)
+				for(unsigned b = 0; b < 256; ++b)
+					mul[a][b] = (a == 0 || b == 0) ? 0 : exp[log[a] + log[b]];
+
+			for(unsigned c = 0; c < 256; ++c)
+				for(unsigned n = 0; n < 16; ++n)
+				{
+					mulLow[c][n] = mul[c][n];
+					mulHigh[c][n] = mul[c][n << 4];
+				}
+		}
+	};
+
+	const GFTables& tables()
+	{
+		static const GFTables t;
+		return t;
+	}
+
+	void mulAddScalar(uint8_t* dst, const uint8_t* src, uint8_t coef, size_t size)
+	{
+		const uint8_t* row = tables().mul[coef];
+		for(size_t i = 0; i < size; ++i)
+			dst[i] ^= row[src[i]];
+	}
+
+	using MulAddKernel = void (*)(uint8_t*, const uint8_t*, uint8_t, size_t);
+
+#if defined(FEC_X86_DISPATCH)
+
+	__attribute__((target("ssse3")))
+	void mulAddSSSE3(uint8_t* dst, const uint8_t* src, uint8_t coef, size_t size)
+	{
+		const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables().mulLow[coef]));
+		const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables().mulHigh[coef]));
+		const __m128i nibble = _mm_set1_epi8(0x0F);
+		size_t i = 0;
+		for(; i + 16 <= size; i += 16)
+		{
+			__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+			__m128i l = _mm_shuffle_epi8(low, _mm_and_si128(s, nibble));
+			__m128i h = _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi64(s, 4), nibble));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(d, _mm_xor_si128(l, h)));
+		}
+		mulAddScalar(dst + i, src + i, coef, size - i);
+	}
+
+	__attribute__((target("avx2")))
+	void mulAddAVX2(uint8_t* dst, const uint8_t* src, uint8_t coef, size_t size)
+	{
+		const __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tables().mulLow[coef])));
+		const __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tables().mulHigh[coef])));
+		const __m256i nibble = _mm256_set1_epi8(0x0F);
+		size_t i = 0;
+		for(; i + 32 <= size; i += 32)
+		{
+			__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+			__m256i l = _mm256_shuffle_epi8(low, _mm256_and_si256(s, nibble));
+			__m256i h = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi64(s, 4), nibble));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(d, _mm256_xor_si256(l, h)));
+		}
+		mulAddScalar(dst + i, src + i, coef, size - i);
+	}
+
+	MulAddKernel selectKernel()
+	{
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2"))
+			return mulAddAVX2;
+		if(__builtin_cpu_supports("ssse3"))
+			return mulAddSSSE3;
+		return mulAddScalar;
+	}
+
+#else
+
+	MulAddKernel selectKernel()
+	{
+		return mulAddScalar;
+	}
+
+#endif
+
+	void xorInto(uint8_t* dst, const uint8_t* src, size_t size)
+	{
+		for(size_t i = 0; i < size; ++i)
+			dst[i] ^= src[i];
+	}
+}
+
+uint8_t gfMul(uint8_t a, uint8_t b) noexcept
+{
+	return tables().mul[a][b];
+}
+
+uint8_t gfInv(uint8_t a) noexcept
+{
+	if(a == 0)
+		return 0;
+	return tables().exp[255 - tables().log[a]];
+}
+
+void gfMulAdd(uint8_t* dst, const uint8_t* src, uint8_t coef, size_t size) noexcept
+{
+	static const MulAddKernel kernel = selectKernel();
+	if(coef == 0 || size == 0)
+		return;
+	if(coef == 1)
+	{
+		xorInto(dst, src, size);
+		return;
+	}
+	kernel(dst, src, coef, size);
+}
+
+uint8_t fecCoefficient(uint8_t k, uint8_t m, uint8_t parityIndex, uint8_t dataIndex) noexcept
+{
+	if(m == 1)
+		return 1;
+	return gfInv(static_cast<uint8_t>((k + parityIndex) ^ dataIndex));
+}
+
+void FecHeader::write(uint8_t* out) const noexcept
+{
+	uint16_t id = hton(blockId);
+	memcpy(out, &id, sizeof(id));
+	out[2] = index;
+	out[3] = k;
+	out[4] = m;
+}
+
+FecHeader FecHeader::read(const uint8_t* in) noexcept
+{
+	uint16_t id;
+	memcpy(&id, in, sizeof(id));
+	return FecHeader{ ntoh(id), in[2], in[3], in[4] };
+}
+
+// ────────────────────────────────────────────────
+//  FecEncoder
+// ────────────────────────────────────────────────
+
+FecEncoder::FecEncoder(uint8_t k, uint8_t m, size_t maxFrameSize, uint16_t firstBlockId) :
+k_(k), m_(m), blockId_(firstBlockId), symbolCapacity_(maxFrameSize + FEC_SYMBOL_OVERHEAD), parity_(m * symbolCapacity_, 0)
+{}
+
+bool FecEncoder::add(std::initializer_list<std::span<const uint8_t>> pieces)
+{
+	size_t length = 0;
+	for(std::span<const uint8_t> piece : pieces)
+		length += piece.size();
+
+	uint8_t prefix[FEC_SYMBOL_OVERHEAD] = { static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length) };
+	for(uint8_t j = 0; j < m_; ++j)
+	{
+		uint8_t coef = fecCoefficient(k_, m_, j, index_);
+		uint8_t* parity = parity_.data() + j * symbolCapacity_;
+		gfMulAdd(parity, prefix, coef, FEC_SYMBOL_OVERHEAD);
+		size_t offset = FEC_SYMBOL_OVERHEAD;
+		for(std::span<const uint8_t> piece : pieces)
+		{
+			gfMulAdd(parity + offset, piece.data(), coef, piece.size());
+			offset += piece.size();
+		}
+	}
+
+	if(length + FEC_SYMBOL_OVERHEAD > paritySize_)
+		paritySize_ = length + FEC_SYMBOL_OVERHEAD;
+	return ++index_ == k_;
+}
+
+void FecEncoder::nextBlock()
+{
+	memset(parity_.data(), 0, parity_.size());
+	paritySize_ = 0;
+	index_ = 0;
+	++blockId_;
+}
+
+// ────────────────────────────────────────────────
+//  FecDecoder
+// ────────────────────────────────────────────────
+
+FecDecoder::FecDecoder(size_t slots, uint8_t maxK, uint8_t maxM, size_t maxFrameSize) :
+symbolCapacity_(maxFrameSize + FEC_SYMBOL_OVERHEAD), maxK_(maxK), maxM_(maxM), blocks_(slots),
+matrix_(static_cast<size_t>(maxK) * maxK), inverse_(static_cast<size_t>(maxK) * maxK)
+{
+	size_t symbols = static_cast<size_t>(maxK) + maxM;
+	for(Block& block : blocks_)
+	{
+		block.have.resize(symbols);
+		block.sizes.resize(symbols);
+		block.symbols.resize(symbols * symbolCapacity_);
+	}
+	pending_.reserve(maxK);
+}
+
+FecDecoder::Block* FecDecoder::findOrAllocate(const Endpoint& peer, const FecHeader& header)
+{
+	Block* victim = nullptr;
+	for(Block& block : blocks_)
+	{
+		if(block.active && block.peer == peer && block.blockId == header.blockId)
+			return block.k == header.k && block.m == header.m ? &block : nullptr;
+		// Свободный слот, иначе самый старый блок
+		if(!victim || (victim->active && (!block.active || block.age < victim->age)))
+			victim = &block;
+	}
+	if(!victim)
+		return nullptr;
+
+	victim->active = true;
+	victim->peer = peer;
+	victim->blockId = header.blockId;
+	victim->k = header.k;
+	victim->m = header.m;
+	victim->received = 0;
+	victim->recovered = false;
+	victim->paritySize = 0;
+	victim->age = ++clock_;
+	std::fill(victim->have.begin(), victim->have.end(), 0);
+	return victim;
+}
+
+bool FecDecoder::add(const Endpoint& peer, const FecHeader& header, std::initializer_list<std::span<const uint8_t>> pieces)
+{
+	pending_.clear();
+	pendingRead_ = 0;
+	if(header.k == 0 || header.m == 0 || header.k > maxK_ || header.m > maxM_ || header.index >= header.k + header.m)
+		return true;
+
+	size_t length = 0;
+	for(std::span<const uint8_t> piece : pieces)
+		length += piece.size();
+
+	bool parity = header.index >= header.k;
+	size_t symbolSize = parity ? length : length + FEC_SYMBOL_OVERHEAD;
+	if(symbolSize > symbolCapacity_)
+		return true;
+
+	Block* block = findOrAllocate(peer, header);
+	if(!block)
+		return true;
+	if(block->have[header.index])
+		return parity; // повтор parity безвреден, повтор кадра данных отбрасывается
+
+	uint8_t* symbol = block->symbols.data() + header.index * symbolCapacity_;
+	size_t offset = 0;
+	if(!parity)
+	{
+		symbol[0] = static_cast<uint8_t>(length >> 8);
+		symbol[1] = static_cast<uint8_t>(length);
+		offset = FEC_SYMBOL_OVERHEAD;
+	}
+	for(std::span<const uint8_t> piece : pieces)
+	{
+		memcpy(symbol + offset, piece.data(), piece.size());
+		offset += piece.size();
+	}
+	block->have[header.index] = 1;
+	block->sizes[header.index] = static_cast<uint16_t>(symbolSize);
+	++block->received;
+	if(parity)
+		block->paritySize = symbolSize;
+
+	if(!block->recovered && block->paritySize > 0 && block->received >= block->k)
+		tryRecover(*block);
+	return true;
+}
+
+void FecDecoder::tryRecover(Block& block)
+{
+	const uint8_t k = block.k;
+	const size_t size = block.paritySize;
+
+	uint8_t missing[256];
+	size_t missingCount = 0;
+	for(uint8_t i = 0; i < k; ++i)
+		if(!block.have[i])
+			missing[missingCount++] = i;
+	if(missingCount == 0)
+	{
+		block.recovered = true;
+		return;
+	}
+
+	// Выбираем k принятых строк: все имеющиеся данные + первые parity
+	uint8_t rows[256];
+	size_t rowCount = 0;
+	for(uint8_t i = 0; i < k; ++i)
+		if(block.have[i])
+			rows[rowCount++] = i;
+	for(uint8_t j = 0; j < block.m && rowCount < k; ++j)
+		if(block.have[k + j])
+		{
+			if(block.sizes[k + j] != size)
+				return;
+			rows[rowCount++] = k + j;
+		}
+	if(rowCount < k)
+		return;
+
+	// Дополняем короткие символы данных нулями до размера parity
+	for(uint8_t i = 0; i < k; ++i)
+	{
+		if(!block.have[i])
+			continue;
+		if(block.sizes[i] > size)
+			return;
+		uint8_t* symbol = block.symbols.data() + i * symbolCapacity_;
+		memset(symbol + block.sizes[i], 0, size - block.sizes[i]);
+	}
+
+	// Матрица A (k x k) принятых строк и её обращение методом Гаусса-Жордана
+	uint8_t* a = matrix_.data();
+	uint8_t* inv = inverse_.data();
+	for(size_t r = 0; r < k; ++r)
+		for(size_t c = 0; c < k; ++c)
+		{
+			a[r * k + c] = rows[r] < k ? (rows[r] == c ? 1 : 0) : fecCoefficient(k, block.m, rows[r] - k, static_cast<uint8_t>(c));
+			inv[r * k + c] = r == c ? 1 : 0;
+		}
+	for(size_t col = 0; col < k; ++col)
+	{
+		size_t pivot = col;
+		while(pivot < k && a[pivot * k + col] == 0)
+			++pivot;
+		if(pivot == k)
+			return;
+		if(pivot != col)
+			for(size_t c = 0; c < k; ++c)
+			{
+				std::swap(a[pivot * k + c], a[col * k + c]);
+				std::swap(inv[pivot * k + c], inv[col * k + c]);
+			}
+		uint8_t scale = gfInv(a[col * k + col]);
+		for(size_t c = 0; c < k; ++c)
+		{
+			a[col * k + c] = gfMul(a[col * k + c], scale);
+			inv[col * k + c] = gfMul(inv[col * k + c], scale);
+		}
+		for(size_t r = 0; r < k; ++r)
+		{
+			uint8_t factor = a[r * k + col];
+			if(r == col || factor == 0)
+				continue;
+			for(size_t c = 0; c < k; ++c)
+			{
+				a[r * k + c] ^= gfMul(factor, a[col * k + c]);
+				inv[r * k + c] ^= gfMul(factor, inv[col * k + c]);
+			}
+		}
+	}
+
+	// D_i = sum_r inv[i][r] * R_r для каждого потерянного i
+	for(size_t n = 0; n < missingCount; ++n)
+	{
+		uint8_t i = missing[n];
+		uint8_t* out = block.symbols.data() + i * symbolCapacity_;
+		memset(out, 0, size);
+		for(size_t r = 0; r < k; ++r)
+			gfMulAdd(out, block.symbols.data() + rows[r] * symbolCapacity_, inv[i * k + r], size);
+
+		size_t length = static_cast<size_t>(out[0]) << 8 | out[1];
+		if(length + FEC_SYMBOL_OVERHEAD > size)
+			continue;
+		block.have[i] = 1;
+		block.sizes[i] = static_cast<uint16_t>(length + FEC_SYMBOL_OVERHEAD);
+		pending_.emplace_back(&block, i);
+		++recoveredCount_;
+	}
+	block.recovered = true;
+}
+
+std::optional<FecRecoveredFrame> FecDecoder::popRecovered()
+{
+	if(pendingRead_ >= pending_.size())
+		return std::nullopt;
+	auto [block, index] = pending_[pendingRead_++];
+	const uint8_t* symbol = block->symbols.data() + index * symbolCapacity_;
+	return FecRecoveredFrame{ block->peer, symbol + FEC_SYMBOL_OVERHEAD, block->sizes[index] - FEC_SYMBOL_OVERHEAD };
+}
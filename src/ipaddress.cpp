@@ -1,44 +1,133 @@
 #include <ipaddress.h>
 
-std::optional<IPAddress> IPAddress::fromString(std::string_view str)
+#include <cstring>
+
+namespace
 {
-	std::array<uint8_t, 4> octets;
-	size_t pos = 0;
-	for(int i = 0; i < 4; ++i)
+	// Текст октета: младшие 3 байта — цифры, старший — их количество
+	constexpr std::array<uint32_t, 256> makeOctetText()
+	{
+		std::array<uint32_t, 256> table{};
+		for(uint32_t i = 0; i < 256; ++i)
+		{
+			if(i < 10)
+				table[i] = (1u << 24) | ('0' + i);
+			else if(i < 100)
+				table[i] = (2u << 24) | (('0' + i % 10) << 8) | ('0' + i / 10);
+			else
+				table[i] = (3u << 24) | (('0' + i % 10) << 16) | (('0' + i / 10 % 10) << 8) | ('0' + i / 100);
+		}
+		return table;
+	}
+
+	constexpr std::array<uint32_t, 256> OCTET_TEXT = makeOctetText();
+
+	constexpr uint64_t ONES = 0x0101010101010101ull;
+	constexpr uint64_t HIGH = 0x8080808080808080ull;
+
+	// Байты 0x80/0x00 -> по биту на байт, младший байт — младший бит
+	uint32_t byteMask(uint64_t highBits) noexcept
+	{
+		return static_cast<uint32_t>(((highBits >> 7) * 0x0102040810204080ull) >> 56);
+	}
+
+	uint32_t dotMask(uint64_t word) noexcept
+	{
+		uint64_t x = word ^ (ONES * '.');
+		uint64_t zero = ~(((x & ~HIGH) + ~HIGH) | x | ~HIGH);
+		return byteMask(zero);
+	}
+
+	uint32_t digitMask(uint64_t word) noexcept
+	{
+		uint64_t low = word & ~HIGH; // без переносов между байтами: 0x7F + 0x50 < 0x100
+		uint64_t atLeast0 = low + ONES * (0x80 - '0');
+		uint64_t above9 = low + ONES * (0x80 - '9' - 1);
+		return byteMask(atLeast0 & ~above9 & ~word & HIGH);
+	}
+}
+
+std::optional<IPAddress> IPAddress::fromStringFast(std::string_view str) noexcept
+{
+	if constexpr (std::endian::native != std::endian::little)
+		return fromStringScalar(str);
+
+	size_t size = str.size();
+	if(size < 7 || size > MAX_STRING_SIZE)
+		return std::nullopt;
+
+	// Строка целиком помещается в два 64-битных слова: классифицируем все байты сразу.
+	// Слова собираются перекрывающимися загрузками, без копирования во временный буфер
+	// и без чтения за пределами строки.
+	const char* data = str.data();
+	uint64_t lo;
+	uint64_t hi = 0;
+	if(size >= 8)
 	{
-		size_t end = str.find('.', pos);
-		if(i < 3 && end == std::string_view::npos) 
-			return std::nullopt;
-		if(i == 3 && end != std::string_view::npos)
-			return std::nullopt;
-		
-		std::string_view subStr = i == 3 ? str.substr(pos) : str.substr(pos, end-pos);
-		if(subStr.empty() || subStr.size() > 3)
-			return std::nullopt;
-		uint16_t val = 0;
-		for(char c: subStr)
+		memcpy(&lo, data, 8);
+		if(size > 8)
 		{
-			if( c < '0' || c > '9')
-				return std::nullopt;
-			val = val * 10 + (c - '0');
-			if(val > 255)
-				return std::nullopt;
+			memcpy(&hi, data + size - 8, 8);
+			hi >>= (16 - size) * 8;
 		}
-		octets[i] = val;
 	}
-	return IPAddress(octets);
+	else
+	{
+		uint32_t head;
+		uint32_t tail;
+		memcpy(&head, data, 4);
+		memcpy(&tail, data + size - 4, 4);
+		lo = head | static_cast<uint64_t>(tail) << ((size - 4) * 8);
+	}
+
+	uint32_t used = (1u << size) - 1;
+	uint32_t dots = (dotMask(lo) | dotMask(hi) << 8) & used;
+	uint32_t digits = (digitMask(lo) | digitMask(hi) << 8) & used;
+	if((dots | digits) != used || (dots & 1) || std::popcount(dots) != 3)
+		return std::nullopt;
+
+	// Октеты без ветвлений: лишние старшие цифры обнуляются множителем,
+	// а их индексы не выходят за начало октета (строка не начинается с точки)
+	uint32_t packed = 0;
+	uint32_t ends = dots | (1u << size);
+	uint32_t start = 0;
+	bool valid = true;
+	for(int i = 0; i < 4; ++i)
+	{
+		uint32_t end = static_cast<uint32_t>(std::countr_zero(ends));
+		ends &= ends - 1;
+		uint32_t length = end - start;
+		uint32_t has2 = length >= 2;
+		uint32_t has3 = length >= 3;
+		uint32_t value = static_cast<uint32_t>(data[end - 1] - '0')
+			+ static_cast<uint32_t>(data[end - 1 - has2] - '0') * 10 * has2
+			+ static_cast<uint32_t>(data[end - 1 - has2 - has3] - '0') * 100 * has3;
+		valid &= (length - 1 <= 2) & (value <= 255);
+		packed |= value << (i * 8);
+		start = end + 1;
+	}
+	if(!valid)
+		return std::nullopt;
+	return IPAddress(packed);
 }
 
-std::optional<IPAddress> IPAddress::fromString(const char* str)
+char* IPAddress::toChars(char* buffer) const noexcept
 {
-	return str ? fromString(std::string_view(str)) : std::nullopt;
+	for(size_t i = 0; i < 4; ++i)
+	{
+		uint32_t text = OCTET_TEXT[octets_[i]];
+		uint8_t digits[4] = { static_cast<uint8_t>(text), static_cast<uint8_t>(text >> 8), static_cast<uint8_t>(text >> 16), '.' };
+		memcpy(buffer, digits, 4); // цифры и точка одной записью, лишнее перезапишет следующий октет
+		size_t length = text >> 24;
+		if(length < 3)
+			buffer[length] = '.';
+		buffer += length + 1;
+	}
+	return buffer - 1;
 }
 
 std::ostream& operator<<(std::ostream& stream, const IPAddress& ip)
 {
-	stream << static_cast<int>(ip[0]) << '.'
-	<< static_cast<int>(ip[1]) << '.'
-	<< static_cast<int>(ip[2]) << '.'
-	<< static_cast<int>(ip[3]);
-	return stream;
-}
\ No newline at end of file
+	char buffer[IPAddress::MAX_STRING_SIZE + 1];
+	return stream.write(buffer, ip.toChars(buffer) - buffer);
+}
@@ -0,0 +1,198 @@
+#include <jitterBuffer.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+JitterBuffer::JitterBuffer(size_t capacity, size_t maxFrameSize, Clock::duration minDelay, Clock::duration maxDelay) :
+maxFrameSize_(maxFrameSize), minDelay_(minDelay), maxDelay_(maxDelay), delay_(minDelay)
+{
+	if(capacity == 0 || maxFrameSize == 0)
+		throw std::invalid_argument("JitterBuffer::JitterBuffer(size_t, size_t, Clock::duration, Clock::duration) capacity and maxFrameSize must be positive");
+	if(minDelay > maxDelay)
+		throw std::invalid_argument("JitterBuffer::JitterBuffer(size_t, size_t, Clock::duration, Clock::duration) minDelay must not exceed maxDelay");
+	size_t slots = 1;
+	while(slots < capacity)
+		slots *= 2;
+	slots_.resize(slots);
+	data_.resize(slots * maxFrameSize);
+	mask_ = slots - 1;
+}
+
+JitterBuffer::Clock::time_point JitterBuffer::playoutTime(const Slot& slot) const
+{
+	return Clock::time_point(slot.mediaTime + std::chrono::nanoseconds(baseTransit_) + delay_);
+}
+
+void JitterBuffer::updateJitter(Clock::duration mediaTime, Clock::time_point arrival)
+{
+	int64_t transit = std::chrono::duration_cast<std::chrono::nanoseconds>(arrival.time_since_epoch() - mediaTime).count();
+	if(!haveTransit_)
+	{
+		haveTransit_ = true;
+		baseTransit_ = transit;
+		lastTransit_ = transit;
+	}
+	else
+	{
+		int64_t difference = transit - lastTransit_;
+		jitter_ += (static_cast<double>(difference < 0 ? -difference : difference) - jitter_) / 16;
+		lastTransit_ = transit;
+		// Минимум берётся сразу, рост — медленно, чтобы следовать за дрейфом часов отправителя
+		if(transit < baseTransit_)
+			baseTransit_ = transit;
+		else
+			baseTransit_ += (transit - baseTransit_) / 1024;
+	}
+	Clock::duration target = std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(static_cast<int64_t>(jitter_ * jitterFactor_)));
+	delay_ = std::clamp(target, minDelay_, maxDelay_);
+}
+
+void JitterBuffer::skip()
+{
+	Slot& slot = slotOf(nextSequence_);
+	if(slot.filled)
+	{
+		slot.filled = false;
+		++stats_.overflow;
+	}
+	else
+		++stats_.lost;
+	++nextSequence_;
+}
+
+void JitterBuffer::resetWindow(uint32_t next, uint32_t skipped)
+{
+	// Пропущенные номера учитываются так же, как в skip(): принятые — overflow, прочие — lost
+	uint32_t filled = 0;
+	for(Slot& slot : slots_)
+	{
+		if(slot.filled)
+			++filled;
+		slot.filled = false;
+	}
+	stats_.overflow += filled;
+	stats_.lost += skipped - filled;
+	nextSequence_ = next;
+	endSequence_ = next;
+}
+
+bool JitterBuffer::push(uint32_t sequence, Clock::duration mediaTime, const uint8_t* data, size_t size, Clock::time_point arrival)
+{
+	if(size > maxFrameSize_)
+		return false;
+	++stats_.received;
+	if(!started_)
+	{
+		started_ = true;
+		nextSequence_ = sequence;
+		endSequence_ = sequence;
+	}
+
+	int32_t behind = static_cast<int32_t>(nextSequence_ - sequence);
+	if(behind > static_cast<int32_t>(slots_.size()))
+	{
+		// Откат дальше окна — не опоздание, а перезапуск отправителя: ждавшие очереди кадры
+		// уже не придут, а метки времени нового потока идут от другой эпохи
+		resetWindow(sequence, endSequence_ - nextSequence_);
+		haveTransit_ = false;
+	}
+	else if(behind > 0)
+	{
+		++stats_.late;
+		return false;
+	}
+	// Кадр за пределами окна: сдвигаем окно, выталкивая самые старые кадры
+	if(sequence - nextSequence_ >= slots_.size())
+	{
+		uint32_t newNext = sequence - static_cast<uint32_t>(slots_.size()) + 1;
+		if(newNext - nextSequence_ > slots_.size())
+			resetWindow(newNext, newNext - nextSequence_); // разрыв больше окна: всё старое уже не нужно
+		while(nextSequence_ != newNext)
+			skip();
+		if(static_cast<int32_t>(endSequence_ - nextSequence_) < 0)
+			endSequence_ = nextSequence_;
+	}
+
+	Slot& slot = slotOf(sequence);
+	if(slot.filled)
+	{
+		++stats_.duplicates;
+		return false;
+	}
+	memcpy(data_.data() + (sequence & mask_) * maxFrameSize_, data, size);
+	slot.filled = true;
+	slot.sequence = sequence;
+	slot.mediaTime = mediaTime;
+	slot.size = size;
+	if(static_cast<int32_t>(sequence - endSequence_) >= 0)
+		endSequence_ = sequence + 1;
+
+	updateJitter(mediaTime, arrival);
+	return true;
+}
+
+bool JitterBuffer::push(const ReceiveInfo& info, Clock::duration mediaTime, const uint8_t* data, Clock::time_point arrival)
+{
+	if(!info.sequence.has_value())
+		return false;
+	return push(info.sequence.value(), mediaTime, data, info.dataSize, arrival);
+}
+
+std::optional<JitterFrame> JitterBuffer::pop(uint8_t* buffer, size_t maxSize, Clock::time_point now)
+{
+	while(nextSequence_ != endSequence_)
+	{
+		Slot& slot = slotOf(nextSequence_);
+		if(slot.filled)
+		{
+			if(playoutTime(slot) > now)
+				return std::nullopt;
+			size_t size = slot.size < maxSize ? slot.size : maxSize;
+			memcpy(buffer, data_.data() + (nextSequence_ & mask_) * maxFrameSize_, size);
+			slot.filled = false;
+			++nextSequence_;
+			++stats_.played;
+			return JitterFrame{ slot.sequence, size, slot.mediaTime };
+		}
+
+		// Кадра нет: ждём его, пока не подойдёт время первого из принятых после него
+		uint32_t sequence = nextSequence_ + 1;
+		while(sequence != endSequence_ && !slotOf(sequence).filled)
+			++sequence;
+		if(sequence == endSequence_ || playoutTime(slotOf(sequence)) > now)
+			return std::nullopt;
+		while(nextSequence_ != sequence)
+			skip();
+	}
+	return std::nullopt;
+}
+
+std::optional<JitterBuffer::Clock::time_point> JitterBuffer::nextPlayout() const
+{
+	for(uint32_t sequence = nextSequence_; sequence != endSequence_; ++sequence)
+		if(slotOf(sequence).filled)
+			return playoutTime(slotOf(sequence));
+	return std::nullopt;
+}
+
+void JitterBuffer::setDelayLimits(Clock::duration minDelay, Clock::duration maxDelay)
+{
+	if(minDelay > maxDelay)
+		throw std::invalid_argument("JitterBuffer::setDelayLimits(Clock::duration, Clock::duration) minDelay must not exceed maxDelay");
+	minDelay_ = minDelay;
+	maxDelay_ = maxDelay;
+	delay_ = std::clamp(delay_, minDelay_, maxDelay_);
+}
+
+void JitterBuffer::reset()
+{
+	for(Slot& slot : slots_)
+		slot.filled = false;
+	started_ = false;
+	nextSequence_ = 0;
+	endSequence_ = 0;
+	haveTransit_ = false;
+	jitter_ = 0;
+	delay_ = minDelay_;
+}
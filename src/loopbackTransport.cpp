@@ -0,0 +1,165 @@
+#include <loopbackTransport.h>
+
+#include <bit>
+#include <mutex>
+#include <stdexcept>
+
+// ────────────────────────────────────────────────
+//  LoopbackNetwork
+// ────────────────────────────────────────────────
+
+Endpoint LoopbackNetwork::attach(LoopbackTransport* node, const NetAddress& ip, uint16_t port)
+{
+	std::unique_lock lock(mutex_);
+	if(port == 0)
+	{
+		for(size_t attempt = 0; attempt < 16384; ++attempt)
+		{
+			uint16_t candidate = nextPort_;
+			nextPort_ = nextPort_ == 65535 ? 49152 : nextPort_ + 1;
+			if(!nodes_.contains(Endpoint{ ip, candidate }))
+			{
+				port = candidate;
+				break;
+			}
+		}
+		if(port == 0)
+			throw std::runtime_error("LoopbackTransport::LoopbackTransport(LoopbackNetwork&, NetAddress, uint16_t, size_t) no free ports on " + ip.toString());
+	}
+	Endpoint local{ ip, port };
+	if(!nodes_.emplace(local, node).second)
+		throw std::runtime_error("LoopbackTransport::LoopbackTransport(LoopbackNetwork&, NetAddress, uint16_t, size_t) address already in use: "
+			+ ip.toString() + ":" + std::to_string(port));
+	return local;
+}
+
+void LoopbackNetwork::detach(const Endpoint& local)
+{
+	std::unique_lock lock(mutex_);
+	nodes_.erase(local);
+}
+
+LoopbackTransport* LoopbackNetwork::find(const NetAddress& ip, uint16_t port) const
+{
+	auto it = nodes_.find(Endpoint{ ip, port });
+	if(it == nodes_.end()) // узел, привязанный ко всем адресам
+		it = nodes_.find(Endpoint{ ip.isV4() ? NetAddress(IPAddress(0, 0, 0, 0)) : NET_ANY6, port });
+	return it == nodes_.end() ? nullptr : it->second;
+}
+
+size_t LoopbackNetwork::size() const
+{
+	std::shared_lock lock(mutex_);
+	return nodes_.size();
+}
+
+// ────────────────────────────────────────────────
+//  LoopbackTransport
+// ────────────────────────────────────────────────
+
+LoopbackTransport::LoopbackTransport(LoopbackNetwork& network, NetAddress ip, uint16_t port, size_t capacity) :
+network_(network), mask_(std::bit_ceil(capacity < 2 ? size_t(2) : capacity) - 1)
+{
+	slots_ = std::make_unique<Slot[]>(mask_ + 1);
+	for(size_t i = 0; i <= mask_; ++i)
+		slots_[i].sequence.store(i, std::memory_order_relaxed);
+	local_ = network_.attach(this, ip, port);
+	source_ = local_;
+	if(ip.isUnspecified() || ip == NetAddress(IPAddress(0, 0, 0, 0)))
+		source_.ip = ip.isV4() ? NetAddress(IPAddress(127, 0, 0, 1)) : NET_LOCALHOST6;
+}
+
+LoopbackTransport::~LoopbackTransport()
+{
+	network_.detach(local_); // после этого отправители не найдут узел
+}
+
+uint32_t LoopbackTransport::getBindInterface()
+{
+	std::optional<IPAddress> v4 = local_.ip.toV4();
+	return v4.has_value() ? v4->toNet() : 0;
+}
+
+// Кольцо Вьюкова: номер в слоте говорит, свободен он (== позиции записи) или занят (== позиции + 1)
+bool LoopbackTransport::push(const Endpoint& source, const DatagramView& datagram)
+{
+	size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+	Slot* slot;
+	for(;;)
+	{
+		slot = &slots_[pos & mask_];
+		size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+		if(diff == 0)
+		{
+			if(enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if(diff < 0)
+		{
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else
+			pos = enqueuePos_.load(std::memory_order_relaxed);
+	}
+
+	size_t size = datagram.headerSize + datagram.payloadSize + datagram.trailerSize;
+	if(slot->data.size() < size)
+		slot->data.resize(size);
+	uint8_t* out = slot->data.data();
+	if(datagram.headerSize)
+		memcpy(out, datagram.header, datagram.headerSize);
+	if(datagram.payloadSize)
+		memcpy(out + datagram.headerSize, datagram.payload, datagram.payloadSize);
+	if(datagram.trailerSize)
+		memcpy(out + datagram.headerSize + datagram.payloadSize, datagram.trailer, datagram.trailerSize);
+	slot->size = size;
+	slot->source = source;
+	slot->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+void LoopbackTransport::deliver(const DatagramView& datagram, const NetAddress& ip, uint16_t port)
+{
+	std::optional<IPAddress> v4 = ip.toV4();
+	if(v4.has_value() && (v4.value() == IP_BROADCAST || v4->isMulticast()))
+	{
+		for(const auto& [endpoint, node] : network_.nodes_)
+			if(endpoint.port == port && node != this)
+				node->push(source_, datagram);
+		return;
+	}
+	if(LoopbackTransport* node = network_.find(ip, port))
+		node->push(source_, datagram);
+}
+
+std::variant<size_t, UDPError> LoopbackTransport::send_batch(const DatagramView* datagrams, size_t count, IPAddress ip)
+{
+	std::shared_lock lock(network_.mutex_);
+	for(size_t i = 0; i < count; ++i)
+		deliver(datagrams[i], ip, local_.port);
+	return count; // как у UDP: недоставленные датаграммы теряются молча
+}
+
+std::variant<size_t, UDPError> LoopbackTransport::send_batch(const DatagramView* datagrams, const Endpoint* destinations, size_t count)
+{
+	std::shared_lock lock(network_.mutex_);
+	for(size_t i = 0; i < count; ++i)
+		deliver(datagrams[i], destinations[i].ip, destinations[i].port);
+	return count;
+}
+
+std::variant<ReceiveInfo, UDPError> LoopbackTransport::recieve(uint8_t* buf, size_t size)
+{
+	Slot& slot = slots_[dequeuePos_ & mask_];
+	if(slot.sequence.load(std::memory_order_acquire) != dequeuePos_ + 1)
+		return RECEIVE_NONE;
+
+	size_t copied = slot.size < size ? slot.size : size; // лишнее отрезается, как у recvfrom
+	memcpy(buf, slot.data.data(), copied);
+	ReceiveInfo info(copied, slot.source.ip.toV4(), slot.source.port, slot.source.ip);
+	slot.sequence.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+	++dequeuePos_;
+	return info;
+}
@@ -0,0 +1,177 @@
+#include <netaddress.h>
+
+namespace
+{
+	int hexDigit(char c)
+	{
+		if(c >= '0' && c <= '9')
+			return c - '0';
+		if(c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if(c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	std::optional<NetAddress> parseV6(std::string_view str)
+	{
+		uint16_t head[8];
+		uint16_t tail[8];
+		size_t headCount = 0;
+		size_t tailCount = 0;
+		bool compressed = false;
+
+		size_t pos = 0;
+		if(str.starts_with("::"))
+		{
+			compressed = true;
+			pos = 2;
+		}
+		while(pos < str.size())
+		{
+			uint16_t* groups = compressed ? tail : head;
+			size_t& count = compressed ? tailCount : headCount;
+			if(headCount + tailCount >= 8)
+				return std::nullopt;
+
+			size_t end = str.find(':', pos);
+			std::string_view group = str.substr(pos, end == std::string_view::npos ? std::string_view::npos : end - pos);
+
+			if(group.find('.') != std::string_view::npos) // последние 32 бита в точечной записи
+			{
+				std::optional<IPAddress> v4 = IPAddress::fromString(group);
+				if(!v4.has_value() || end != std::string_view::npos || headCount + tailCount > 6)
+					return std::nullopt;
+				groups[count++] = static_cast<uint16_t>(v4->first() << 8 | v4->second());
+				groups[count++] = static_cast<uint16_t>(v4->third() << 8 | v4->fourth());
+				pos = str.size();
+				break;
+			}
+
+			if(group.empty() || group.size() > 4)
+				return std::nullopt;
+			uint16_t value = 0;
+			for(char c : group)
+			{
+				int digit = hexDigit(c);
+				if(digit < 0)
+					return std::nullopt;
+				value = static_cast<uint16_t>(value << 4 | digit);
+			}
+			groups[count++] = value;
+
+			if(end == std::string_view::npos)
+			{
+				pos = str.size();
+				break;
+			}
+			pos = end + 1;
+			if(pos < str.size() && str[pos] == ':')
+			{
+				if(compressed)
+					return std::nullopt; // второе "::"
+				compressed = true;
+				++pos;
+			}
+			else if(pos == str.size())
+				return std::nullopt; // одиночное ':' в конце
+		}
+
+		size_t total = headCount + tailCount;
+		if(compressed ? total > 7 : total != 8)
+			return std::nullopt;
+
+		std::array<uint8_t, 16> bytes{};
+		for(size_t i = 0; i < headCount; ++i)
+		{
+			bytes[i * 2] = static_cast<uint8_t>(head[i] >> 8);
+			bytes[i * 2 + 1] = static_cast<uint8_t>(head[i]);
+		}
+		for(size_t i = 0; i < tailCount; ++i)
+		{
+			size_t index = 8 - tailCount + i;
+			bytes[index * 2] = static_cast<uint8_t>(tail[i] >> 8);
+			bytes[index * 2 + 1] = static_cast<uint8_t>(tail[i]);
+		}
+		return NetAddress(bytes);
+	}
+}
+
+std::optional<NetAddress> NetAddress::fromString(std::string_view str)
+{
+	if(str.find(':') == std::string_view::npos)
+	{
+		std::optional<IPAddress> v4 = IPAddress::fromString(str);
+		if(!v4.has_value())
+			return std::nullopt;
+		return NetAddress(v4.value());
+	}
+	return parseV6(str);
+}
+
+std::optional<NetAddress> NetAddress::fromString(const char* str)
+{
+	return str ? fromString(std::string_view(str)) : std::nullopt;
+}
+
+std::string NetAddress::toString() const
+{
+	if(std::optional<IPAddress> v4 = toV4())
+		return v4->toString();
+
+	uint16_t groups[8];
+	for(size_t i = 0; i < 8; ++i)
+		groups[i] = static_cast<uint16_t>(bytes_[i * 2] << 8 | bytes_[i * 2 + 1]);
+
+	// Самая длинная (первая из равных) серия нулевых групп длиной от 2 заменяется на "::"
+	size_t bestStart = 8;
+	size_t bestLength = 1;
+	for(size_t i = 0; i < 8;)
+	{
+		if(groups[i] != 0)
+		{
+			++i;
+			continue;
+		}
+		size_t j = i;
+		while(j < 8 && groups[j] == 0)
+			++j;
+		if(j - i > bestLength)
+		{
+			bestStart = i;
+			bestLength = j - i;
+		}
+		i = j;
+	}
+
+	static constexpr char HEX[] = "0123456789abcdef";
+	std::string result;
+	result.reserve(39);
+	for(size_t i = 0; i < 8; ++i)
+	{
+		if(i == bestStart)
+		{
+			result += "::";
+			i += bestLength - 1;
+			continue;
+		}
+		if(i > 0 && i != bestStart + bestLength)
+			result += ':';
+		bool started = false;
+		for(int shift = 12; shift >= 0; shift -= 4)
+		{
+			unsigned digit = groups[i] >> shift & 0xF;
+			if(digit != 0 || started || shift == 0)
+			{
+				result += HEX[digit];
+				started = true;
+			}
+		}
+	}
+	return result;
+}
+
+std::ostream& operator<<(std::ostream& stream, const NetAddress& address)
+{
+	return stream << address.toString();
+}
@@ -0,0 +1,204 @@
+#include <netemTransport.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	// Минимальная куча по времени отправки
+	bool later(const auto& a, const auto& b)
+	{
+		return a.due != b.due ? a.due > b.due : a.order > b.order;
+	}
+
+	size_t datagramSize(const DatagramView& datagram)
+	{
+		return datagram.headerSize + datagram.payloadSize + datagram.trailerSize;
+	}
+}
+
+NetemTransport::NetemTransport(Transport& inner, NetemConfig config) :
+inner_(inner)
+{
+	setConfig(config);
+}
+
+void NetemTransport::setConfig(const NetemConfig& config)
+{
+	for(double probability : { config.loss, config.duplicate, config.reorder })
+		if(!(probability >= 0 && probability <= 1))
+			throw std::invalid_argument("void NetemTransport::setConfig(const NetemConfig&) probabilities must be in [0, 1]");
+	if(config.delay.count() < 0 || config.jitter.count() < 0)
+		throw std::invalid_argument("void NetemTransport::setConfig(const NetemConfig&) delay and jitter must not be negative");
+	if(config.limit == 0)
+		throw std::invalid_argument("void NetemTransport::setConfig(const NetemConfig&) limit must be positive");
+	config_ = config;
+	random_.seed(config.seed);
+}
+
+// Своё преобразование в [0, 1) вместо uniform_real_distribution: последовательность
+// одинакова во всех стандартных библиотеках
+double NetemTransport::uniform()
+{
+	return static_cast<double>(random_() >> 11) * 0x1.0p-53;
+}
+
+bool NetemTransport::chance(double probability)
+{
+	return probability > 0 && uniform() < probability;
+}
+
+bool NetemTransport::immediate() const
+{
+	return config_.delay.count() == 0 && config_.jitter.count() == 0 && config_.rate == 0;
+}
+
+void NetemTransport::enqueue(const DatagramView& datagram, const Endpoint& destination, Clock::time_point now)
+{
+	// Отброшенная из-за limit датаграмма не занимает ни канал, ни очередь
+	if(queue_.size() >= config_.limit)
+	{
+		++stats_.overflow;
+		return;
+	}
+
+	size_t size = datagramSize(datagram);
+	Clock::time_point due = now;
+	if(config_.rate > 0) // полоса: датаграмма занимает канал на время передачи
+	{
+		linkFree_ = std::max(now, linkFree_) + std::chrono::nanoseconds(size * 1000000000ull / config_.rate);
+		due = linkFree_;
+	}
+	if(config_.reorder > 0 && chance(config_.reorder))
+		++stats_.reordered;
+	else
+	{
+		Clock::duration delay = config_.delay;
+		if(config_.jitter.count() > 0)
+		{
+			double offset = (uniform() * 2 - 1) * static_cast<double>(config_.jitter.count());
+			delay += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(offset));
+		}
+		if(delay > Clock::duration::zero())
+			due += delay;
+	}
+
+	std::vector<uint8_t> data;
+	if(!spare_.empty())
+	{
+		data = std::move(spare_.back());
+		spare_.pop_back();
+	}
+	data.resize(size);
+	if(datagram.headerSize)
+		memcpy(data.data(), datagram.header, datagram.headerSize);
+	if(datagram.payloadSize)
+		memcpy(data.data() + datagram.headerSize, datagram.payload, datagram.payloadSize);
+	if(datagram.trailerSize)
+		memcpy(data.data() + datagram.headerSize + datagram.payloadSize, datagram.trailer, datagram.trailerSize);
+
+	queue_.push_back(Pending{ due, order_++, destination, std::move(data) });
+	std::push_heap(queue_.begin(), queue_.end(), later<Pending, Pending>);
+}
+
+std::variant<size_t, UDPError> NetemTransport::send(const DatagramView* datagrams, const Endpoint* destinations, size_t count, IPAddress ip)
+{
+	stats_.sent += count;
+	bool direct = immediate();
+	Clock::time_point now = Clock::now();
+	views_.clear();
+	destinations_.clear();
+	for(size_t i = 0; i < count; ++i)
+	{
+		if(chance(config_.loss))
+		{
+			++stats_.lost;
+			continue;
+		}
+		size_t copies = 1;
+		if(chance(config_.duplicate))
+		{
+			++stats_.duplicated;
+			copies = 2;
+		}
+		for(size_t copy = 0; copy < copies; ++copy)
+		{
+			if(direct)
+			{
+				views_.push_back(datagrams[i]);
+				if(destinations)
+					destinations_.push_back(destinations[i]);
+			}
+			else // в очереди адресат хранится с портом, на который ушла бы датаграмма
+				enqueue(datagrams[i], destinations ? destinations[i] : Endpoint{ ip, inner_.getBindPort() }, now);
+		}
+	}
+
+	if(!direct)
+	{
+		poll(now);
+		return count;
+	}
+	if(views_.empty())
+		return count;
+	std::variant<size_t, UDPError> rc = destinations
+		? inner_.send_batch(views_.data(), destinations_.data(), views_.size())
+		: inner_.send_batch(views_.data(), views_.size(), ip);
+	if(std::holds_alternative<UDPError>(rc))
+		return rc;
+	stats_.delivered += std::get<size_t>(rc);
+	return count; // потерянные эмулятором считаются отправленными, как в настоящей сети
+}
+
+size_t NetemTransport::poll(Clock::time_point now)
+{
+	if(queue_.empty() || queue_.front().due > now)
+		return 0;
+
+	ready_.clear();
+	while(!queue_.empty() && queue_.front().due <= now)
+	{
+		std::pop_heap(queue_.begin(), queue_.end(), later<Pending, Pending>);
+		ready_.push_back(std::move(queue_.back()));
+		queue_.pop_back();
+	}
+
+	views_.clear();
+	destinations_.clear();
+	for(const Pending& pending : ready_)
+	{
+		views_.push_back(DatagramView{ pending.data.data(), pending.data.size(), nullptr, 0 });
+		destinations_.push_back(pending.destination);
+	}
+	std::variant<size_t, UDPError> rc = inner_.send_batch(views_.data(), destinations_.data(), views_.size());
+	size_t sent = std::holds_alternative<size_t>(rc) ? std::get<size_t>(rc) : 0;
+	stats_.delivered += sent;
+	stats_.failed += ready_.size() - sent; // ошибку отправки из очереди вернуть некому
+
+	for(Pending& pending : ready_)
+		spare_.push_back(std::move(pending.data));
+	return sent;
+}
+
+std::optional<NetemTransport::Clock::time_point> NetemTransport::nextDue() const
+{
+	if(queue_.empty())
+		return std::nullopt;
+	return queue_.front().due;
+}
+
+std::variant<size_t, UDPError> NetemTransport::send_batch(const DatagramView* datagrams, size_t count, IPAddress ip)
+{
+	return send(datagrams, nullptr, count, ip);
+}
+
+std::variant<size_t, UDPError> NetemTransport::send_batch(const DatagramView* datagrams, const Endpoint* destinations, size_t count)
+{
+	return send(datagrams, destinations, count, IPAddress(0, 0, 0, 0));
+}
+
+std::variant<ReceiveInfo, UDPError> NetemTransport::recieve(uint8_t* buf, size_t size)
+{
+	poll();
+	return inner_.recieve(buf, size);
+}
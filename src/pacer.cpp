@@ -0,0 +1,26 @@
+#include <pacer.h>
+
+#include <stdexcept>
+
+TokenBucket::TokenBucket(uint64_t bytesPerSecond, size_t burstBytes, Clock::time_point now) :
+rate_(static_cast<double>(bytesPerSecond) / 1e9), burst_(static_cast<double>(burstBytes)), tokens_(burst_), last_(now)
+{
+	if(bytesPerSecond == 0 || burstBytes == 0)
+		throw std::invalid_argument("TokenBucket::TokenBucket(uint64_t, size_t, Clock::time_point) rate and burst must be positive");
+}
+
+TokenBucket::Clock::duration TokenBucket::reserve(size_t bytes, Clock::time_point now)
+{
+	if(now > last_)
+	{
+		double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count());
+		tokens_ += elapsed * rate_;
+		if(tokens_ > burst_)
+			tokens_ = burst_;
+		last_ = now;
+	}
+	tokens_ -= static_cast<double>(bytes);
+	if(tokens_ >= 0)
+		return Clock::duration::zero();
+	return std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(static_cast<int64_t>(-tokens_ / rate_)));
+}
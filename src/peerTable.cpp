@@ -0,0 +1,125 @@
+#include <peerTable.h>
+
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+	constexpr size_t NOT_FOUND = SIZE_MAX;
+}
+
+PeerTable::PeerTable(size_t capacity) : capacity_(capacity)
+{
+	if(capacity == 0)
+		throw std::invalid_argument("PeerTable::PeerTable(size_t) capacity must be positive");
+	size_t slots = 4;
+	while(slots < capacity * 2)
+		slots *= 2;
+	slots_.resize(slots);
+	mask_ = slots - 1;
+}
+
+size_t PeerTable::findIndex(const Endpoint& endpoint) const
+{
+	for(size_t i = home(endpoint);; i = (i + 1) & mask_)
+	{
+		if(!slots_[i].used)
+			return NOT_FOUND;
+		if(slots_[i].session.endpoint == endpoint)
+			return i;
+	}
+}
+
+PeerSession* PeerTable::find(const Endpoint& endpoint)
+{
+	size_t i = findIndex(endpoint);
+	return i == NOT_FOUND ? nullptr : &slots_[i].session;
+}
+
+const PeerSession* PeerTable::find(const Endpoint& endpoint) const
+{
+	size_t i = findIndex(endpoint);
+	return i == NOT_FOUND ? nullptr : &slots_[i].session;
+}
+
+PeerSession& PeerTable::touch(const Endpoint& endpoint, Clock::time_point now)
+{
+	size_t i = home(endpoint);
+	for(; slots_[i].used; i = (i + 1) & mask_)
+	{
+		if(slots_[i].session.endpoint == endpoint)
+		{
+			slots_[i].session.lastSeen = now;
+			return slots_[i].session;
+		}
+	}
+
+	if(size_ == capacity_)
+	{
+		size_t oldest = NOT_FOUND;
+		for(size_t j = 0; j < slots_.size(); ++j)
+			if(slots_[j].used && (oldest == NOT_FOUND || slots_[j].session.lastSeen < slots_[oldest].session.lastSeen))
+				oldest = j;
+		eraseAt(oldest);
+		++evicted_;
+		// сдвиг мог освободить ячейку ближе к home
+		for(i = home(endpoint); slots_[i].used; i = (i + 1) & mask_)
+			;
+	}
+
+	slots_[i].used = true;
+	slots_[i].session = PeerSession{};
+	slots_[i].session.endpoint = endpoint;
+	slots_[i].session.lastSeen = now;
+	++size_;
+	return slots_[i].session;
+}
+
+void PeerTable::eraseAt(size_t index)
+{
+	// Сдвигаем назад элементы цепочки, чья домашняя ячейка не лежит между index и их позицией
+	for(size_t j = (index + 1) & mask_; slots_[j].used; j = (j + 1) & mask_)
+	{
+		size_t h = home(slots_[j].session.endpoint);
+		if(((j - h) & mask_) >= ((j - index) & mask_))
+		{
+			slots_[index].session = std::move(slots_[j].session);
+			index = j;
+		}
+	}
+	slots_[index].used = false;
+	--size_;
+}
+
+bool PeerTable::erase(const Endpoint& endpoint)
+{
+	size_t i = findIndex(endpoint);
+	if(i == NOT_FOUND)
+		return false;
+	eraseAt(i);
+	return true;
+}
+
+size_t PeerTable::evictIdle(Clock::duration timeout, Clock::time_point now)
+{
+	size_t removed = 0;
+	for(size_t i = 0; i < slots_.size();)
+	{
+		// после удаления в ячейку i мог сдвинуться следующий элемент, проверяем её снова
+		if(slots_[i].used && now - slots_[i].session.lastSeen > timeout)
+		{
+			eraseAt(i);
+			++removed;
+		}
+		else
+			++i;
+	}
+	return removed;
+}
+
+void PeerTable::clear()
+{
+	for(Slot& slot : slots_)
+		slot.used = false;
+	size_ = 0;
+}
@@ -0,0 +1,127 @@
+#include <reassembly.h>
+
+#include <cstring>
+
+void FragmentHeader::write(uint8_t* out) const noexcept
+{
+	uint16_t fields[4] = { hton(messageId), hton(index), hton(count), hton(chunkSize) };
+	memcpy(out, fields, SIZE);
+}
+
+FragmentHeader FragmentHeader::read(const uint8_t* in) noexcept
+{
+	uint16_t fields[4];
+	memcpy(fields, in, SIZE);
+	return FragmentHeader{ ntoh(fields[0]), ntoh(fields[1]), ntoh(fields[2]), ntoh(fields[3]) };
+}
+
+ReassemblyTable::ReassemblyTable(size_t slots, size_t maxMessageSize, Clock::duration timeout) :
+slots_(slots), maxMessageSize_(maxMessageSize), timeout_(timeout)
+{
+	for(Slot& slot : slots_)
+	{
+		slot.data.resize(maxMessageSize);
+		slot.mask.reserve((UINT16_MAX + 1) / 8);
+	}
+}
+
+void ReassemblyTable::evictExpired(Clock::time_point now)
+{
+	for(Slot& slot : slots_)
+	{
+		if(slot.active && now - slot.started > timeout_)
+		{
+			slot.active = false;
+			++evicted_;
+		}
+	}
+}
+
+void ReassemblyTable::clear()
+{
+	for(Slot& slot : slots_)
+		slot.active = false;
+}
+
+ReassemblyTable::Slot* ReassemblyTable::findOrAllocate(const Endpoint& peer, uint16_t messageId, Clock::time_point now)
+{
+	Slot* free = nullptr;
+	Slot* oldest = nullptr;
+	for(Slot& slot : slots_)
+	{
+		if(!slot.active)
+		{
+			if(!free)
+				free = &slot;
+			continue;
+		}
+		if(slot.peer == peer && slot.messageId == messageId)
+			return &slot;
+		if(now - slot.started > timeout_)
+		{
+			slot.active = false;
+			++evicted_;
+			if(!free)
+				free = &slot;
+			continue;
+		}
+		if(!oldest || slot.started < oldest->started)
+			oldest = &slot;
+	}
+	if(!free)
+	{
+		if(!oldest)
+			return nullptr;
+		free = oldest;
+		++evicted_;
+	}
+	free->active = false;
+	free->peer = peer;
+	free->messageId = messageId;
+	free->received = 0;
+	free->started = now;
+	return free;
+}
+
+std::optional<ReassembledMessage> ReassemblyTable::insert(const Endpoint& peer, uint8_t flags, const FragmentHeader& header,
+	const uint8_t* data, size_t size, Clock::time_point now)
+{
+	if(header.count == 0 || header.index >= header.count || header.chunkSize == 0)
+		return std::nullopt;
+	bool last = header.index + 1 == header.count;
+	if(last ? size > header.chunkSize : size != header.chunkSize)
+		return std::nullopt;
+	size_t offset = static_cast<size_t>(header.index) * header.chunkSize;
+	if(offset + size > maxMessageSize_)
+		return std::nullopt;
+
+	Slot* slot = findOrAllocate(peer, header.messageId, now);
+	if(!slot)
+		return std::nullopt;
+
+	if(!slot->active)
+	{
+		slot->active = true;
+		slot->count = header.count;
+		slot->chunkSize = header.chunkSize;
+		slot->flags = flags;
+		slot->size = 0;
+		slot->mask.assign((header.count + 7) / 8, 0);
+	}
+	else if(slot->count != header.count || slot->chunkSize != header.chunkSize || slot->flags != flags)
+		return std::nullopt;
+
+	uint8_t bit = static_cast<uint8_t>(1 << (header.index % 8));
+	if(slot->mask[header.index / 8] & bit) // дубликат
+		return std::nullopt;
+	slot->mask[header.index / 8] |= bit;
+
+	memcpy(slot->data.data() + offset, data, size);
+	if(last)
+		slot->size = offset + size;
+	if(++slot->received < slot->count)
+		return std::nullopt;
+
+	slot->active = false;
+	return ReassembledMessage{ slot->data.data(), slot->size, slot->flags };
+}
@@ -0,0 +1,138 @@
+#include <snapshotStore.h>
+
+#include <stdexcept>
+
+SnapshotStore::SnapshotStore(size_t capacity, size_t maxSize) :
+capacity_(capacity), maxSize_(maxSize), wordsPerSlot_((maxSize + 7) / 8)
+{
+	if(capacity == 0 || maxSize == 0)
+		throw std::invalid_argument("SnapshotStore::SnapshotStore(size_t, size_t) capacity and maxSize must be positive");
+	size_t slots = 4;
+	while(slots < capacity * 2)
+		slots *= 2;
+	slots_ = std::make_unique<Slot[]>(slots);
+	words_ = std::make_unique<std::atomic<uint64_t>[]>(slots * wordsPerSlot_);
+	mask_ = slots - 1;
+}
+
+const SnapshotStore::Slot* SnapshotStore::find(const Endpoint& peer, uint32_t channel) const
+{
+	for(size_t i = home(peer, channel);; i = (i + 1) & mask_)
+	{
+		const Slot& slot = slots_[i];
+		// Ключ неизменен после публикации used, acquire делает его видимым
+		if(!slot.used.load(std::memory_order_acquire))
+			return nullptr;
+		if(slot.channel == channel && slot.peer == peer)
+			return &slot;
+	}
+}
+
+SnapshotStore::Slot* SnapshotStore::findOrInsert(const Endpoint& peer, uint32_t channel)
+{
+	for(size_t i = home(peer, channel);; i = (i + 1) & mask_)
+	{
+		Slot& slot = slots_[i];
+		if(!slot.used.load(std::memory_order_relaxed))
+		{
+			if(size_.load(std::memory_order_relaxed) >= capacity_)
+				return nullptr;
+			slot.peer = peer;
+			slot.channel = channel;
+			slot.used.store(true, std::memory_order_release);
+			size_.fetch_add(1, std::memory_order_relaxed);
+			return &slot;
+		}
+		if(slot.channel == channel && slot.peer == peer)
+			return &slot;
+	}
+}
+
+bool SnapshotStore::publish(const Endpoint& peer, uint32_t channel, const uint8_t* data, size_t size, Clock::time_point now)
+{
+	Slot* slot = findOrInsert(peer, channel);
+	if(!slot)
+	{
+		overflow_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	if(size > maxSize_)
+		size = maxSize_;
+
+	uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+	slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	std::atomic<uint64_t>* words = words_.get() + (slot - slots_.get()) * wordsPerSlot_;
+	size_t full = size / 8;
+	for(size_t i = 0; i < full; ++i)
+	{
+		uint64_t word;
+		memcpy(&word, data + i * 8, 8);
+		words[i].store(word, std::memory_order_relaxed);
+	}
+	if(size % 8)
+	{
+		uint64_t word = 0;
+		memcpy(&word, data + full * 8, size % 8);
+		words[full].store(word, std::memory_order_relaxed);
+	}
+	slot->size.store(size, std::memory_order_relaxed);
+	slot->updated.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+
+	slot->sequence.store(sequence + 2, std::memory_order_release);
+	return true;
+}
+
+std::optional<SnapshotInfo> SnapshotStore::readSlot(const Slot& slot, uint8_t* buffer, size_t maxSize) const
+{
+	uint64_t before = slot.sequence.load(std::memory_order_acquire);
+	if(before == 0 || (before & 1))
+		return std::nullopt; // значения ещё нет или писатель обновляет слот
+
+	size_t size = slot.size.load(std::memory_order_relaxed);
+	int64_t updated = slot.updated.load(std::memory_order_relaxed);
+	size_t copy = size < maxSize ? size : maxSize;
+	if(copy > maxSize_)
+		copy = maxSize_; // размер мог быть прочитан во время записи
+	const std::atomic<uint64_t>* words = words_.get() + (&slot - slots_.get()) * wordsPerSlot_;
+	size_t full = copy / 8;
+	for(size_t i = 0; i < full; ++i)
+	{
+		uint64_t word = words[i].load(std::memory_order_relaxed);
+		memcpy(buffer + i * 8, &word, 8);
+	}
+	if(copy % 8)
+	{
+		uint64_t word = words[full].load(std::memory_order_relaxed);
+		memcpy(buffer + full * 8, &word, copy % 8);
+	}
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(slot.sequence.load(std::memory_order_relaxed) != before)
+		return std::nullopt;
+	return SnapshotInfo{ size, before / 2, Clock::time_point(Clock::duration(updated)) };
+}
+
+std::optional<SnapshotInfo> SnapshotStore::tryRead(const Endpoint& peer, uint32_t channel, uint8_t* buffer, size_t maxSize) const
+{
+	const Slot* slot = find(peer, channel);
+	if(!slot)
+		return std::nullopt;
+	return readSlot(*slot, buffer, maxSize);
+}
+
+std::optional<SnapshotInfo> SnapshotStore::read(const Endpoint& peer, uint32_t channel, uint8_t* buffer, size_t maxSize) const
+{
+	const Slot* slot = find(peer, channel);
+	if(!slot)
+		return std::nullopt;
+	for(;;)
+	{
+		std::optional<SnapshotInfo> info = readSlot(*slot, buffer, maxSize);
+		if(info.has_value())
+			return info;
+		if(slot->sequence.load(std::memory_order_relaxed) == 0)
+			return std::nullopt;
+	}
+}
@@ -19,6 +19,7 @@
     #include <fcntl.h>
     #include <ifaddrs.h>
     #include <errno.h>
+    #include <sys/uio.h>
 #endif
 
 #ifdef _WIN32
@@ -62,6 +63,47 @@ namespace {
     #define WOULD_BLOCK_ERR  EWOULDBLOCK
 #endif
 
+// ────────────────────────────────────────────────
+//  Адреса сокета
+// ────────────────────────────────────────────────
+
+namespace
+{
+    struct SocketAddress
+    {
+        union
+        {
+            sockaddr base;
+            sockaddr_in v4;
+            sockaddr_in6 v6;
+        };
+        socklen_t length;
+    };
+
+    // netPort в сетевом порядке. На сокете двойного стека IPv4 передаётся как IPv4-mapped.
+    SocketAddress makeAddress(const NetAddress& ip, uint16_t netPort, bool dualStack)
+    {
+        SocketAddress addr;
+        std::optional<IPAddress> v4 = ip.toV4();
+        if (!dualStack && v4.has_value())
+        {
+            memset(&addr.v4, 0, sizeof(addr.v4));
+            addr.v4.sin_family      = AF_INET;
+            addr.v4.sin_addr.s_addr = v4->toNet();
+            addr.v4.sin_port        = netPort;
+            addr.length = sizeof(sockaddr_in);
+            return addr;
+        }
+
+        memset(&addr.v6, 0, sizeof(addr.v6));
+        addr.v6.sin6_family = AF_INET6;
+        addr.v6.sin6_port   = netPort;
+        memcpy(&addr.v6.sin6_addr, ip.bytes().data(), 16);
+        addr.length = sizeof(sockaddr_in6);
+        return addr;
+    }
+}
+
 // ────────────────────────────────────────────────
 //  UDPSocket реализация
 // ────────────────────────────────────────────────
@@ -105,6 +147,18 @@ UDPSocket::UDPSocket(UDPSocket&& other) noexcept
 
     intefaceIP_ = other.intefaceIP_;
     other.intefaceIP_ = IPAddress(0,0,0,0).toNet();
+
+    receiveBufferSize_ = other.receiveBufferSize_;
+    sendBufferSize_ = other.sendBufferSize_;
+    pacingRate_ = other.pacingRate_;
+    dualStack_ = other.dualStack_;
+    selfFilter_ = other.selfFilter_;
+    localIPs_ = std::move(other.localIPs_);
+    localIPsUpdated_ = other.localIPsUpdated_;
+    groups_ = std::move(other.groups_);
+    multicastInterface_ = other.multicastInterface_;
+    multicastTTL_ = other.multicastTTL_;
+    multicastLoop_ = other.multicastLoop_;
 }
 
 UDPSocket& UDPSocket::operator=(UDPSocket&& other) noexcept
@@ -124,6 +178,18 @@ UDPSocket& UDPSocket::operator=(UDPSocket&& other) noexcept
 
         intefaceIP_ = other.intefaceIP_;
         other.intefaceIP_ = IPAddress(0,0,0,0).toNet();
+
+        receiveBufferSize_ = other.receiveBufferSize_;
+        sendBufferSize_ = other.sendBufferSize_;
+        pacingRate_ = other.pacingRate_;
+        dualStack_ = other.dualStack_;
+        selfFilter_ = other.selfFilter_;
+        localIPs_ = std::move(other.localIPs_);
+        localIPsUpdated_ = other.localIPsUpdated_;
+        groups_ = std::move(other.groups_);
+        multicastInterface_ = other.multicastInterface_;
+        multicastTTL_ = other.multicastTTL_;
+        multicastLoop_ = other.multicastLoop_;
     }
     return *this;
 }
@@ -142,12 +208,19 @@ void UDPSocket::reset()
         throw std::runtime_error("WSAStartup failed");
 #endif
 
-    sock_ = socket(AF_INET, SOCK_DGRAM, 0);
+    sock_ = socket(dualStack_ ? AF_INET6 : AF_INET, SOCK_DGRAM, 0);
     if (sock_ == INVALID_SOCK)
         throw std::runtime_error("socket() failed");
 
     int enable = 1;
 
+    int v6only = 0;
+    if (dualStack_ && setsockopt(sock_, IPPROTO_IPV6, IPV6_V6ONLY,
+                   reinterpret_cast<const char*>(&v6only), sizeof(v6only)) == SOCK_ERROR)
+    {
+        std::cerr << "Warning: setsockopt(IPV6_V6ONLY) failed\n";
+    }
+
     // SO_BROADCAST
     if (setsockopt(sock_, SOL_SOCKET, SO_BROADCAST,
                    reinterpret_cast<const char*>(&enable), sizeof(enable)) == SOCK_ERROR)
@@ -162,6 +235,34 @@ void UDPSocket::reset()
         std::cerr << "Warning: setsockopt(SO_REUSEADDR) failed\n";
     }
 
+    if (receiveBufferSize_ > 0 && setsockopt(sock_, SOL_SOCKET, SO_RCVBUF,
+                   reinterpret_cast<const char*>(&receiveBufferSize_), sizeof(receiveBufferSize_)) == SOCK_ERROR)
+    {
+        std::cerr << "Warning: setsockopt(SO_RCVBUF) failed\n";
+    }
+
+    if (sendBufferSize_ > 0 && setsockopt(sock_, SOL_SOCKET, SO_SNDBUF,
+                   reinterpret_cast<const char*>(&sendBufferSize_), sizeof(sendBufferSize_)) == SOCK_ERROR)
+    {
+        std::cerr << "Warning: setsockopt(SO_SNDBUF) failed\n";
+    }
+
+    if (pacingRate_ > 0 && applyPacingRate().has_value())
+    {
+        std::cerr << "Warning: setsockopt(SO_MAX_PACING_RATE) failed\n";
+    }
+
+    if (applyMulticastOptions().has_value())
+    {
+        std::cerr << "Warning: setsockopt(IP_MULTICAST_*) failed\n";
+    }
+
+    for (const MulticastMembership& membership : groups_)
+    {
+        if (applyMembership(membership, true).has_value())
+            std::cerr << "Warning: setsockopt(IP_ADD_MEMBERSHIP) failed\n";
+    }
+
     // Non-blocking mode
 #ifdef _WIN32
     u_long mode = 1;
@@ -182,13 +283,16 @@ std::optional<UDPError> UDPSocket::bind()
 {
     reset();
 
-    sockaddr_in addr{};
-    addr.sin_family      = AF_INET;
-    addr.sin_addr.s_addr = intefaceIP_;
-    addr.sin_port        = port_;   // предполагается, что уже в сетевом порядке (htons)
+    // port_ предполагается уже в сетевом порядке (htons)
+    SocketAddress addr = dualStack_ && intefaceIP_ == INADDR_ANY
+        ? makeAddress(NET_ANY6, port_, true)
+        : makeAddress(IPAddress::fromNet(intefaceIP_), port_, dualStack_);
 
-    if (::bind(sock_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+    if (::bind(sock_, &addr.base, addr.length) == 0)
+    {
+        refreshLocalAddresses();
         return std::nullopt;
+    }
 
     return last_udp_error();
 }
@@ -212,17 +316,14 @@ std::optional<UDPError> UDPSocket::bindInteface(IPAddress ip)
 
 std::variant<size_t, UDPError> UDPSocket::send_to(const uint8_t* data, size_t size, uint32_t ip)
 {
-    sockaddr_in addr{};
-    addr.sin_family      = AF_INET;
-    addr.sin_addr.s_addr = ip;
-    addr.sin_port        = port_;
+    SocketAddress addr = makeAddress(IPAddress::fromNet(ip), port_, dualStack_);
 
     int rc = sendto(sock_,
                     reinterpret_cast<const char*>(data),
                     static_cast<int>(size),
                     0,
-                    reinterpret_cast<sockaddr*>(&addr),
-                    sizeof(addr));
+                    &addr.base,
+                    addr.length);
 
     if (rc >= 0)
         return static_cast<size_t>(rc);
@@ -235,31 +336,149 @@ std::variant<size_t, UDPError> UDPSocket::send_to(const uint8_t* data, size_t si
     return send_to(data, size, ip.toNet());
 }
 
+namespace
+{
+    // addressOf(i) возвращает адрес получателя i-й датаграммы
+    template <typename AddressOf>
+    std::variant<size_t, UDPError> sendBatchImpl(socket_t sock, const DatagramView* datagrams, size_t count, AddressOf addressOf)
+    {
+#if defined(_WIN32)
+        for (size_t i = 0; i < count; ++i)
+        {
+            SocketAddress addr = addressOf(i);
+            WSABUF bufs[3];
+            bufs[0].buf = reinterpret_cast<char*>(const_cast<uint8_t*>(datagrams[i].header));
+            bufs[0].len = static_cast<ULONG>(datagrams[i].headerSize);
+            bufs[1].buf = reinterpret_cast<char*>(const_cast<uint8_t*>(datagrams[i].payload));
+            bufs[1].len = static_cast<ULONG>(datagrams[i].payloadSize);
+            bufs[2].buf = reinterpret_cast<char*>(const_cast<uint8_t*>(datagrams[i].trailer));
+            bufs[2].len = static_cast<ULONG>(datagrams[i].trailerSize);
+            DWORD bufCount = datagrams[i].trailerSize ? 3 : 2;
+            DWORD sent = 0;
+            if (WSASendTo(sock, bufs, bufCount, &sent, 0, &addr.base, addr.length, nullptr, nullptr) == SOCK_ERROR)
+            {
+                if (i > 0)
+                    return i;
+                return last_udp_error();
+            }
+        }
+        return count;
+#else
+        constexpr size_t BATCH = 64;
+        size_t sent = 0;
+        while (sent < count)
+        {
+            size_t n = std::min(BATCH, count - sent);
+            iovec iov[BATCH * 3];
+            SocketAddress addrs[BATCH];
+#if defined(__linux__)
+            mmsghdr msgs[BATCH];
+            memset(msgs, 0, sizeof(mmsghdr) * n);
+#else
+            msghdr msgs[BATCH];
+            memset(msgs, 0, sizeof(msghdr) * n);
+#endif
+            for (size_t i = 0; i < n; ++i)
+            {
+                const DatagramView& d = datagrams[sent + i];
+                addrs[i] = addressOf(sent + i);
+                iov[i * 3].iov_base     = const_cast<uint8_t*>(d.header);
+                iov[i * 3].iov_len      = d.headerSize;
+                iov[i * 3 + 1].iov_base = const_cast<uint8_t*>(d.payload);
+                iov[i * 3 + 1].iov_len  = d.payloadSize;
+                iov[i * 3 + 2].iov_base = const_cast<uint8_t*>(d.trailer);
+                iov[i * 3 + 2].iov_len  = d.trailerSize;
+#if defined(__linux__)
+                msghdr& hdr = msgs[i].msg_hdr;
+#else
+                msghdr& hdr = msgs[i];
+#endif
+                hdr.msg_name    = &addrs[i].base;
+                hdr.msg_namelen = addrs[i].length;
+                hdr.msg_iov     = &iov[i * 3];
+                hdr.msg_iovlen  = d.trailerSize ? 3 : 2;
+            }
+
+#if defined(__linux__)
+            int rc = sendmmsg(sock, msgs, static_cast<unsigned>(n), 0);
+            if (rc <= 0)
+            {
+                if (sent > 0)
+                    return sent;
+                return last_udp_error();
+            }
+            sent += static_cast<size_t>(rc);
+#else
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (sendmsg(sock, &msgs[i], 0) < 0)
+                {
+                    if (sent > 0)
+                        return sent;
+                    return last_udp_error();
+                }
+                ++sent;
+            }
+#endif
+        }
+        return sent;
+#endif
+    }
+}
+
+std::variant<size_t, UDPError> UDPSocket::send_batch(const DatagramView* datagrams, size_t count, IPAddress ip)
+{
+    SocketAddress addr = makeAddress(ip, port_, dualStack_);
+
+    return sendBatchImpl(sock_, datagrams, count, [&](size_t) { return addr; });
+}
+
+std::variant<size_t, UDPError> UDPSocket::send_batch(const DatagramView* datagrams, const Endpoint* destinations, size_t count)
+{
+    return sendBatchImpl(sock_, datagrams, count, [&](size_t i)
+    {
+        return makeAddress(destinations[i].ip, htons(destinations[i].port), dualStack_);
+    });
+}
+
 std::variant<ReceiveInfo, UDPError> UDPSocket::recieve(uint8_t* buf, size_t size)
 {
-    sockaddr_in srcaddr{};
-    socklen_t addrlen = sizeof(srcaddr);
+    SocketAddress srcaddr;
+    socklen_t addrlen = sizeof(sockaddr_in6);
 
     int rc = recvfrom(sock_,
                       reinterpret_cast<char*>(buf),
                       static_cast<int>(size),
                       0,
-                      reinterpret_cast<sockaddr*>(&srcaddr),
+                      &srcaddr.base,
                       &addrlen);
 
     if (rc >= 0)
     {
-        if (srcaddr.sin_family == AF_INET)
+        std::optional<IPAddress> remote_ip;
+        NetAddress remote_address;
+        uint16_t remote_port = 0;
+        if (srcaddr.base.sa_family == AF_INET)
+        {
+            remote_ip = IPAddress::fromNet(srcaddr.v4.sin_addr.s_addr);
+            remote_address = remote_ip.value();
+            remote_port = ntohs(srcaddr.v4.sin_port);
+        }
+        else if (srcaddr.base.sa_family == AF_INET6)
         {
-            IPAddress remote_ip = IPAddress::fromNet(srcaddr.sin_addr.s_addr);
-            auto my_ips = intefacesIPs();
+            std::array<uint8_t, 16> bytes;
+            memcpy(bytes.data(), &srcaddr.v6.sin6_addr, 16);
+            remote_address = NetAddress(bytes);
+            remote_ip = remote_address.toV4();
+            remote_port = ntohs(srcaddr.v6.sin6_port);
+        }
+        else
+            return ReceiveInfo(rc, IP_ANY);
 
-            if (std::find(my_ips.begin(), my_ips.end(), remote_ip) != my_ips.end())
-                return RECEIVE_NONE;
+        if (selfFilter_ && remote_ip.has_value() && isLocalAddress(remote_ip.value()))
+            return RECEIVE_FILTERED;
 
-            return ReceiveInfo(rc, remote_ip);
-        }
-        return ReceiveInfo(rc, IP_ANY);
+        return ReceiveInfo(rc, remote_ip, remote_port, remote_address);
     }
 
     UDPError err = last_udp_error();
@@ -269,6 +488,20 @@ std::variant<ReceiveInfo, UDPError> UDPSocket::recieve(uint8_t* buf, size_t size
     return err;
 }
 
+void UDPSocket::refreshLocalAddresses()
+{
+    std::vector<IPAddress> ips = intefacesIPs();
+    localIPs_.assign(ips.begin(), ips.end()); // ёмкость переиспользуется
+    localIPsUpdated_ = std::chrono::steady_clock::now();
+}
+
+bool UDPSocket::isLocalAddress(IPAddress ip)
+{
+    if (std::chrono::steady_clock::now() - localIPsUpdated_ >= LOCAL_ADDRESSES_TTL)
+        refreshLocalAddresses();
+    return std::find(localIPs_.begin(), localIPs_.end(), ip) != localIPs_.end();
+}
+
 uint16_t UDPSocket::getBindPort()
 {
     return ntohs(port_);
@@ -279,6 +512,140 @@ uint32_t UDPSocket::getBindInterface()
     return intefaceIP_;
 }
 
+std::optional<UDPError> UDPSocket::setReceiveBufferSize(int bytes)
+{
+    receiveBufferSize_ = bytes;
+    if (setsockopt(sock_, SOL_SOCKET, SO_RCVBUF,
+                   reinterpret_cast<const char*>(&bytes), sizeof(bytes)) == SOCK_ERROR)
+        return last_udp_error();
+    return std::nullopt;
+}
+
+std::optional<UDPError> UDPSocket::setSendBufferSize(int bytes)
+{
+    sendBufferSize_ = bytes;
+    if (setsockopt(sock_, SOL_SOCKET, SO_SNDBUF,
+                   reinterpret_cast<const char*>(&bytes), sizeof(bytes)) == SOCK_ERROR)
+        return last_udp_error();
+    return std::nullopt;
+}
+
+std::optional<UDPError> UDPSocket::applyPacingRate()
+{
+#if defined(SO_MAX_PACING_RATE)
+    // Старые ядра принимают только 32-битное значение
+    unsigned int rate = pacingRate_ > UINT32_MAX ? UINT32_MAX : static_cast<unsigned int>(pacingRate_);
+    if (setsockopt(sock_, SOL_SOCKET, SO_MAX_PACING_RATE,
+                   reinterpret_cast<const char*>(&rate), sizeof(rate)) == SOCK_ERROR)
+        return last_udp_error();
+    return std::nullopt;
+#else
+    return UDPError::OPERATION_NOT_SUPPORTED;
+#endif
+}
+
+std::optional<UDPError> UDPSocket::setDualStack(bool enable)
+{
+    dualStack_ = enable;
+    return bind();
+}
+
+std::optional<UDPError> UDPSocket::applyMembership(const MulticastMembership& membership, bool join)
+{
+    ip_mreq request{};
+    request.imr_multiaddr.s_addr = membership.group.toNet();
+    request.imr_interface.s_addr = membership.interfaceIP.toNet();
+    if (setsockopt(sock_, IPPROTO_IP, join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+                   reinterpret_cast<const char*>(&request), sizeof(request)) == SOCK_ERROR)
+        return last_udp_error();
+    return std::nullopt;
+}
+
+std::optional<UDPError> UDPSocket::applyMulticastOptions()
+{
+    // Значения по умолчанию совпадают с ядром, их не выставляем
+    std::optional<UDPError> rc;
+    if (multicastInterface_ != IPAddress(0, 0, 0, 0))
+    {
+        in_addr address{};
+        address.s_addr = multicastInterface_.toNet();
+        if (setsockopt(sock_, IPPROTO_IP, IP_MULTICAST_IF,
+                       reinterpret_cast<const char*>(&address), sizeof(address)) == SOCK_ERROR)
+            rc = last_udp_error();
+    }
+    if (multicastTTL_ != 1 && setsockopt(sock_, IPPROTO_IP, IP_MULTICAST_TTL,
+                   reinterpret_cast<const char*>(&multicastTTL_), sizeof(multicastTTL_)) == SOCK_ERROR)
+        rc = last_udp_error();
+    int loop = multicastLoop_ ? 1 : 0;
+    if (!multicastLoop_ && setsockopt(sock_, IPPROTO_IP, IP_MULTICAST_LOOP,
+                   reinterpret_cast<const char*>(&loop), sizeof(loop)) == SOCK_ERROR)
+        rc = last_udp_error();
+    return rc;
+}
+
+std::optional<UDPError> UDPSocket::joinGroup(IPAddress group, IPAddress interfaceIP)
+{
+    if (!group.isMulticast())
+        throw std::invalid_argument("UDPSocket::joinGroup(IPAddress, IPAddress) address is not multicast: " + group.toString());
+
+    MulticastMembership membership{ group, interfaceIP };
+    std::optional<UDPError> rc = applyMembership(membership, true);
+    if (!rc.has_value())
+        groups_.push_back(membership);
+    return rc;
+}
+
+std::optional<UDPError> UDPSocket::leaveGroup(IPAddress group, IPAddress interfaceIP)
+{
+    auto it = std::find_if(groups_.begin(), groups_.end(), [&](const MulticastMembership& membership)
+    {
+        return membership.group == group && membership.interfaceIP == interfaceIP;
+    });
+    if (it == groups_.end())
+        return UDPError::INVALID_ARGUMENT;
+    groups_.erase(it);
+    return applyMembership(MulticastMembership{ group, interfaceIP }, false);
+}
+
+std::optional<UDPError> UDPSocket::setMulticastInterface(IPAddress interfaceIP)
+{
+    multicastInterface_ = interfaceIP;
+    in_addr address{};
+    address.s_addr = interfaceIP.toNet();
+    if (setsockopt(sock_, IPPROTO_IP, IP_MULTICAST_IF,
+                   reinterpret_cast<const char*>(&address), sizeof(address)) == SOCK_ERROR)
+        return last_udp_error();
+    return std::nullopt;
+}
+
+std::optional<UDPError> UDPSocket::setMulticastTTL(uint8_t ttl)
+{
+    multicastTTL_ = ttl;
+    if (setsockopt(sock_, IPPROTO_IP, IP_MULTICAST_TTL,
+                   reinterpret_cast<const char*>(&multicastTTL_), sizeof(multicastTTL_)) == SOCK_ERROR)
+        return last_udp_error();
+    return std::nullopt;
+}
+
+std::optional<UDPError> UDPSocket::setMulticastLoop(bool enable)
+{
+    multicastLoop_ = enable;
+    int loop = enable ? 1 : 0;
+    if (setsockopt(sock_, IPPROTO_IP, IP_MULTICAST_LOOP,
+                   reinterpret_cast<const char*>(&loop), sizeof(loop)) == SOCK_ERROR)
+        return last_udp_error();
+    return std::nullopt;
+}
+
+std::optional<UDPError> UDPSocket::setMaxPacingRate(uint64_t bytesPerSecond)
+{
+    pacingRate_ = bytesPerSecond == 0 ? UINT64_MAX : bytesPerSecond;
+    std::optional<UDPError> rc = applyPacingRate();
+    if (bytesPerSecond == 0)
+        pacingRate_ = 0;
+    return rc;
+}
+
 // ────────────────────────────────────────────────
 //  Получение списка IP-адресов интерфейсов
 // ────────────────────────────────────────────────
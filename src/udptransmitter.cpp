@@ -1 +1,1247 @@
-#include <udptransmitter.h>
\ No newline at end of file
+#include <udptransmitter.h>
+
+#include <compression.h>
+
+#include <algorithm>
+
+namespace
+{
+	constexpr size_t MAX_DATAGRAM_SIZE = 65536;
+	constexpr size_t SEQUENCE_HEADER_SIZE = 4;
+
+	// Кадр FRAME_CONTROL начинается с байта вида. Синхронизация часов: далее три метки
+	// времени int64 big-endian, нс steady_clock. Запрос: t1 — время отправки. Ответ: t1
+	// из запроса, t2 — приём запроса, t3 — отправка ответа. У heartbeat тела нет.
+	constexpr uint8_t CONTROL_CLOCK_REQUEST = 0;
+	constexpr uint8_t CONTROL_CLOCK_RESPONSE = 1;
+	constexpr uint8_t CONTROL_HEARTBEAT = 2;
+	constexpr size_t CLOCK_FRAME_SIZE = 1 + 3 * sizeof(int64_t);
+
+	int64_t steadyNs(std::chrono::steady_clock::time_point time)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+	}
+
+	std::chrono::steady_clock::time_point steadyFromNs(int64_t ns)
+	{
+		return std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns)));
+	}
+
+	constexpr size_t MAX_DRAIN = 4096; // предел вычитывания очереди в receiveLatest
+	// Номер, отставший от последнего принятого больше чем на окно, — не перестановка,
+	// а перезапуск отправителя с новой нумерацией
+	constexpr int32_t REORDER_WINDOW = 1024;
+
+	size_t varintSize(uint64_t value)
+	{
+		size_t size = 1;
+		for(; value >= 0x80; value >>= 7)
+			++size;
+		return size;
+	}
+
+	size_t writeVarint(uint8_t* out, uint64_t value)
+	{
+		size_t size = 0;
+		for(; value >= 0x80; value >>= 7)
+			out[size++] = static_cast<uint8_t>(value) | 0x80;
+		out[size++] = static_cast<uint8_t>(value);
+		return size;
+	}
+
+	bool readVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+		for(unsigned shift = 0; shift < 64 && in < end; shift += 7)
+		{
+			uint8_t byte = *in++;
+			value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if(!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+}
+
+size_t UDPTransmitter::writeHeader(uint8_t* out, uint8_t flags, uint32_t sequence) const
+{
+	size_t magicSize = magicString_.length();
+	memcpy(out, magicString_.c_str(), magicSize);
+	if(!extendedHeader_)
+		return magicSize;
+	if(sequencing_)
+		flags |= FRAME_SEQUENCE;
+	if(checksum_)
+		flags |= FRAME_CHECKSUM;
+	out[magicSize] = flags;
+	size_t size = magicSize + 1;
+	if(sequencing_)
+	{
+		uint32_t net = hton(sequence);
+		memcpy(out + size, &net, sizeof(net));
+		size += SEQUENCE_HEADER_SIZE;
+	}
+	return size;
+}
+
+bool UDPTransmitter::acceptSequence(const Endpoint& peer, uint32_t sequence)
+{
+	// Узел уже добавлен при приёме датаграммы, но мог быть вытеснен до сборки сообщения
+	PeerSession* found = peers_.find(peer);
+	PeerSession& session = found ? *found : peers_.touch(peer);
+	SequenceStats& stats = session.sequence;
+	if(!session.sequenceValid)
+	{
+		session.sequenceValid = true;
+		session.lastSequence = sequence;
+		++stats.received;
+		return true;
+	}
+
+	int32_t diff = static_cast<int32_t>(sequence - session.lastSequence);
+	if(diff > 0)
+	{
+		stats.gaps += static_cast<uint32_t>(diff) - 1;
+		session.lastSequence = sequence;
+		++stats.received;
+		return true;
+	}
+	if(diff < -REORDER_WINDOW)
+	{
+		++stats.restarts;
+		session.lastSequence = sequence;
+		++stats.received;
+		return true;
+	}
+	if(diff == 0)
+		++stats.duplicates;
+	else
+		++stats.reordered;
+	if(dropStale_)
+	{
+		++stats.dropped;
+		return false;
+	}
+	++stats.received;
+	return true;
+}
+
+ssize_t UDPTransmitter::sendControlFrame(const uint8_t* body, size_t bodySize, const Endpoint* peer)
+{
+	uint8_t frame[1 + CLOCK_FRAME_SIZE];
+	if(bodySize > CLOCK_FRAME_SIZE)
+		return -1;
+	frame[0] = FRAME_CONTROL | (checksum_ ? FRAME_CHECKSUM : 0);
+	memcpy(frame + 1, body, bodySize);
+
+	DatagramView datagram{ reinterpret_cast<const uint8_t*>(magicString_.data()), magicString_.length(), frame, 1 + bodySize };
+	if(!peer)
+		return sendBatch(&datagram, 1);
+	destinations_.assign(1, *peer);
+	ssize_t rc = sendBatch(&datagram, 1);
+	destinations_.clear();
+	return rc;
+}
+
+ssize_t UDPTransmitter::sendClockFrame(uint8_t kind, int64_t t1, int64_t t2, const Endpoint* peer)
+{
+	uint8_t body[CLOCK_FRAME_SIZE];
+	body[0] = kind;
+	// t3 берётся последним, непосредственно перед отправкой
+	const int64_t times[3] = { t1, t2, steadyNs(std::chrono::steady_clock::now()) };
+	for(size_t i = 0; i < 3; ++i)
+	{
+		uint64_t net = hton(static_cast<uint64_t>(times[i]));
+		memcpy(body + 1 + i * sizeof(net), &net, sizeof(net));
+	}
+	return sendControlFrame(body, sizeof(body), peer);
+}
+
+ssize_t UDPTransmitter::syncClocks()
+{
+	if(!extendedHeader_)
+		return -1;
+	lastClockProbe_ = std::chrono::steady_clock::now();
+	// Один кадр расходится всем узлам одной пачкой, как sendDataToAll
+	peers_.forEach([&](const PeerSession& session) { destinations_.push_back(session.endpoint); });
+	ssize_t rc = sendClockFrame(CONTROL_CLOCK_REQUEST, steadyNs(lastClockProbe_), 0, nullptr);
+	destinations_.clear();
+	return rc;
+}
+
+void UDPTransmitter::handleControlFrame(const uint8_t* payload, size_t payloadSize, const Endpoint& peer, std::chrono::steady_clock::time_point received)
+{
+	if(payloadSize < 1)
+	{
+		++drops_.malformed;
+		return;
+	}
+	if(payload[0] == CONTROL_HEARTBEAT)
+		return; // живость уже отмечена при приёме датаграммы
+	if(payload[0] > CONTROL_HEARTBEAT)
+		return; // вид из более новой версии: пропускается, а не считается повреждённым
+	if(payloadSize < CLOCK_FRAME_SIZE)
+	{
+		++drops_.malformed;
+		return;
+	}
+	int64_t times[3];
+	for(size_t i = 0; i < 3; ++i)
+	{
+		uint64_t net;
+		memcpy(&net, payload + 1 + i * sizeof(net), sizeof(net));
+		times[i] = static_cast<int64_t>(ntoh(net));
+	}
+
+	if(payload[0] == CONTROL_CLOCK_REQUEST)
+	{
+		sendClockFrame(CONTROL_CLOCK_RESPONSE, times[0], steadyNs(received), &peer);
+		return;
+	}
+	PeerSession* session = peers_.find(peer);
+	if(session)
+		session->clock.addSample(steadyFromNs(times[0]), steadyFromNs(times[1]), steadyFromNs(times[2]), received);
+}
+
+void UDPTransmitter::sendHeartbeats(std::chrono::steady_clock::time_point now)
+{
+	lastHeartbeat_ = now;
+	// Всем известным узлам, а также адресату и резервным адресатам, даже если от них
+	// ещё ничего не приходило: иначе они не узнают о нас и не начнут слать heartbeat
+	peers_.forEach([&](const PeerSession& session) { destinations_.push_back(session.endpoint); });
+	size_t known = destinations_.size();
+	uint16_t port = transport().getBindPort();
+	auto addTarget = [&](IPAddress ip)
+	{
+		if(ip == IP_BROADCAST || ip == IP_ANY)
+			return;
+		NetAddress address(ip);
+		for(size_t i = 0; i < known; ++i)
+			if(destinations_[i].ip == address)
+				return;
+		destinations_.push_back(Endpoint{ address, port });
+	};
+	addTarget(target_);
+	for(IPAddress ip : failoverTargets_)
+		addTarget(ip);
+
+	const uint8_t body = CONTROL_HEARTBEAT;
+	sendControlFrame(&body, 1, nullptr);
+	destinations_.clear();
+}
+
+void UDPTransmitter::watchPeer(PeerSession& session)
+{
+	if(!session.alive)
+	{
+		session.alive = true;
+		if(livenessHandler_)
+			livenessHandler_(session.endpoint, true);
+	}
+	// Таймер не переставляется на каждом пакете: при срабатывании сверяется lastSeen
+	if(session.livenessTimer == TimerWheel<Endpoint>::NONE)
+		session.livenessTimer = livenessTimers_.schedule(session.lastSeen + livenessTimeout_, session.endpoint);
+}
+
+void UDPTransmitter::peerExpired(TimerWheel<Endpoint>::Handle timer, const Endpoint& peer, std::chrono::steady_clock::time_point now)
+{
+	PeerSession* session = peers_.find(peer);
+	if(!session || session->livenessTimer != timer)
+		return; // узел вытеснен из таблицы
+	session->livenessTimer = TimerWheel<Endpoint>::NONE;
+	if(now - session->lastSeen < livenessTimeout_)
+	{
+		session->livenessTimer = livenessTimers_.schedule(session->lastSeen + livenessTimeout_, peer);
+		return;
+	}
+
+	session->alive = false;
+	if(livenessHandler_)
+		livenessHandler_(peer, false);
+	if(!multicastGroup_.has_value() && peer.ip == NetAddress(target_))
+		failover(target_);
+}
+
+void UDPTransmitter::failover(IPAddress dead)
+{
+	if(!primaryTarget_.has_value())
+		primaryTarget_ = dead;
+
+	std::optional<IPAddress> alive;
+	std::optional<IPAddress> unknown;
+	for(IPAddress ip : failoverTargets_)
+	{
+		if(ip == dead)
+			continue;
+		bool known = false;
+		bool up = false;
+		peers_.forEach([&](const PeerSession& session)
+		{
+			if(session.endpoint.ip == NetAddress(ip))
+			{
+				known = true;
+				up = up || session.alive;
+			}
+		});
+		if(up)
+		{
+			alive = ip;
+			break;
+		}
+		if(!known && !unknown.has_value())
+			unknown = ip;
+	}
+
+	flush(); // накопленное предназначалось прежнему адресату
+	if(alive.has_value())
+		target_ = alive.value();
+	else if(failoverBroadcast_ || !unknown.has_value())
+		target_ = IP_BROADCAST;
+	else
+		target_ = unknown.value();
+	++failovers_;
+}
+
+void UDPTransmitter::serviceTimers(std::chrono::steady_clock::time_point now)
+{
+	if(coalesceSize_ > 0 && now - coalesceStarted_ >= coalesceDeadline_)
+		flush();
+	if(clockSync_ && now - lastClockProbe_ >= clockInterval_)
+		syncClocks();
+	if(heartbeat_)
+	{
+		if(now - lastHeartbeat_ >= heartbeatInterval_)
+			sendHeartbeats(now);
+		livenessTimers_.advance(now, [&](TimerWheel<Endpoint>::Handle timer, const Endpoint& peer) { peerExpired(timer, peer, now); });
+	}
+	if(reassembly_)
+		reassembly_->evictExpired(now); // иначе незавершённые сообщения держат слоты до следующего фрагмента
+	if(pacedHead_ < paced_.size())
+		drainPaced(now);
+}
+
+bool UDPTransmitter::filterSender(const ReceiveInfo& info)
+{
+	if(!sourceFilter_)
+		return true;
+	FilterAction action = info.remoteIP.has_value() ? sourceFilter_->check(info.remoteIP.value()) : sourceFilter_->defaultAction();
+	if(action == FilterAction::ALLOW)
+		return true;
+	++drops_.filtered;
+	return false;
+}
+
+bool UDPTransmitter::restorePrimary(std::optional<IPAddress> remoteIP)
+{
+	if(!primaryTarget_.has_value() || remoteIP != primaryTarget_)
+		return false;
+	// Исходный адресат снова на связи: возвращаемся к нему после переключения
+	if(target_ != primaryTarget_.value())
+	{
+		flush();
+		target_ = primaryTarget_.value();
+	}
+	primaryTarget_.reset();
+	return true;
+}
+
+bool UDPTransmitter::acceptControlSender(std::optional<IPAddress> remoteIP) const
+{
+	if(multicastGroup_.has_value() || !lockTargetIP_ || target_ == IP_BROADCAST)
+		return true;
+	if(!remoteIP.has_value())
+		return false;
+	IPAddress ip = remoteIP.value();
+	return ip == target_ || ip == primaryTarget_ ||
+		std::find(failoverTargets_.begin(), failoverTargets_.end(), ip) != failoverTargets_.end();
+}
+
+bool UDPTransmitter::acceptSender(std::optional<IPAddress> remoteIP)
+{
+	if(multicastGroup_.has_value())
+		return true; // ответы идут в группу, а не последнему отправителю
+	if(restorePrimary(remoteIP))
+		return true;
+	if(remoteIP.has_value())
+	{
+		if(target_ != remoteIP.value())
+		{
+			if(lockTargetIP_ && target_ != IP_BROADCAST)
+				return false;
+			flush(); // накопленное предназначалось прежнему адресату
+			target_ = remoteIP.value();
+		}
+
+	}
+	else if(lockTargetIP_ && target_ != IP_BROADCAST)
+		return false; // отправитель IPv6 не совпадает с закреплённым адресатом IPv4
+	if(target_ == IP_ANY)
+		target_ = IP_BROADCAST;
+	return true;
+}
+
+bool UDPTransmitter::setMulticastGroup(IPAddress group, uint8_t ttl, bool loop, IPAddress interfaceIP)
+{
+	if(!group.isMulticast())
+		throw std::invalid_argument("UDPTransmitter::setMulticastGroup(IPAddress, uint8_t, bool, IPAddress) address is not multicast: " + group.toString());
+
+	leaveMulticastGroup();
+	UDPSocket* socket = udpSocket();
+	if(!socket)
+	{
+		std::cerr << udp_error_to_string(UDPError::OPERATION_NOT_SUPPORTED) << std::endl;
+		return false;
+	}
+	std::optional<UDPError> rc = socket->joinGroup(group, interfaceIP);
+	if(!rc.has_value())
+		rc = socket->setMulticastTTL(ttl);
+	if(!rc.has_value())
+		rc = socket->setMulticastLoop(loop);
+	if(!rc.has_value() && interfaceIP != IP_ANY)
+		rc = socket->setMulticastInterface(interfaceIP);
+	if(rc.has_value())
+	{
+		std::cerr << udp_error_to_string(rc.value()) << std::endl;
+		socket->leaveGroup(group, interfaceIP);
+		return false;
+	}
+
+	flush(); // накопленное предназначалось прежнему адресату
+	socket->setSelfFilter(false);
+	multicastGroup_ = group;
+	multicastInterface_ = interfaceIP;
+	target_ = group;
+	return true;
+}
+
+void UDPTransmitter::leaveMulticastGroup()
+{
+	if(!multicastGroup_.has_value())
+		return;
+	flush(); // накопленное предназначалось группе
+	UDPSocket* socket = udpSocket(); // группа бывает только у сокета
+	socket->leaveGroup(multicastGroup_.value(), multicastInterface_);
+	socket->setMulticastLoop(true);
+	socket->setSelfFilter(true);
+	multicastGroup_.reset();
+	target_ = IP_BROADCAST;
+}
+
+void UDPTransmitter::enqueuePaced(const DatagramView& datagram, const Endpoint& destination, std::chrono::steady_clock::time_point deadline)
+{
+	size_t offset = pacedData_.size();
+	pacedData_.insert(pacedData_.end(), datagram.header, datagram.header + datagram.headerSize);
+	pacedData_.insert(pacedData_.end(), datagram.payload, datagram.payload + datagram.payloadSize);
+	if(datagram.trailerSize > 0)
+		pacedData_.insert(pacedData_.end(), datagram.trailer, datagram.trailer + datagram.trailerSize);
+	paced_.push_back(PacedDatagram{ deadline, destination, offset, pacedData_.size() - offset });
+}
+
+void UDPTransmitter::drainPaced(std::chrono::steady_clock::time_point now)
+{
+	size_t due = pacedHead_;
+	while(due < paced_.size() && paced_[due].deadline <= now)
+		++due;
+	if(due == pacedHead_)
+		return;
+
+	// Все подошедшие датаграммы уходят одной пачкой
+	pacedViews_.clear();
+	pacedEndpoints_.clear();
+	for(size_t i = pacedHead_; i < due; ++i)
+	{
+		pacedViews_.push_back(DatagramView{ pacedData_.data() + paced_[i].offset, paced_[i].size, nullptr, 0 });
+		pacedEndpoints_.push_back(paced_[i].destination);
+	}
+	std::variant<size_t, UDPError> rc = transport().send_batch(pacedViews_.data(), pacedEndpoints_.data(), pacedViews_.size());
+	if(std::holds_alternative<UDPError>(rc))
+		std::cerr << udp_error_to_string(std::get<UDPError>(rc)) << std::endl;
+	else if(std::get<size_t>(rc) != pacedViews_.size())
+		std::cerr << "UDPTransmitter: only " << std::get<size_t>(rc) << " of " << pacedViews_.size() << " paced datagrams sent" << std::endl;
+	pacedHead_ = due;
+
+	if(pacedHead_ == paced_.size())
+	{
+		paced_.clear();
+		pacedData_.clear();
+		pacedHead_ = 0;
+	}
+	else if(pacedHead_ * 2 >= paced_.size())
+	{
+		// Отправленная половина очереди сдвигается, чтобы при постоянном отставании буфер не рос
+		size_t shift = paced_[pacedHead_].offset;
+		pacedData_.erase(pacedData_.begin(), pacedData_.begin() + shift);
+		paced_.erase(paced_.begin(), paced_.begin() + pacedHead_);
+		for(PacedDatagram& datagram : paced_)
+			datagram.offset -= shift;
+		pacedHead_ = 0;
+	}
+}
+
+std::variant<size_t, UDPError> UDPTransmitter::transmit(const DatagramView* datagrams, const Endpoint* destinations, size_t count)
+{
+	auto send = [&](size_t n)
+	{
+		if(destinations)
+			return transport().send_batch(datagrams, destinations, n);
+		return transport().send_batch(datagrams, n, target_);
+	};
+	if(!pacer_)
+		return send(count);
+
+	// Датаграммы, на которые хватает токенов, уходят сразу одной пачкой; остальные встают
+	// в очередь со сроком отправки. Пока очередь не пуста, новые датаграммы идут за ней,
+	// чтобы не обгонять ранее отправленные.
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	drainPaced(now);
+	size_t ready = 0;
+	for(size_t i = 0; i < count; ++i)
+	{
+		const DatagramView& d = datagrams[i];
+		TokenBucket::Clock::duration wait = pacer_->reserve(d.headerSize + d.payloadSize + d.trailerSize, now);
+		if(wait <= TokenBucket::Clock::duration::zero() && ready == i && pacedHead_ == paced_.size())
+			++ready;
+		else
+			enqueuePaced(d, destinations ? destinations[i] : Endpoint{ NetAddress(target_), transport().getBindPort() }, now + wait);
+	}
+	if(ready == 0)
+		return count;
+	std::variant<size_t, UDPError> rc = send(ready);
+	if(std::holds_alternative<UDPError>(rc) || std::get<size_t>(rc) != ready)
+		return rc;
+	return count;
+}
+
+ssize_t UDPTransmitter::sendBatch(const DatagramView* datagrams, size_t count)
+{
+	if(checksum_)
+	{
+		// Сумма считается последней, по окончательным заголовкам, и уходит третьей частью датаграммы
+		if(checksumBuf_.size() < count * CRC32C_SIZE)
+			checksumBuf_.resize(count * CRC32C_SIZE);
+		checksumDatagrams_.assign(datagrams, datagrams + count);
+		for(size_t i = 0; i < count; ++i)
+		{
+			DatagramView& d = checksumDatagrams_[i];
+			uint32_t crc = hton(crc32c(d.payload, d.payloadSize, crc32c(d.header, d.headerSize)));
+			uint8_t* trailer = checksumBuf_.data() + i * CRC32C_SIZE;
+			memcpy(trailer, &crc, CRC32C_SIZE);
+			d.trailer = trailer;
+			d.trailerSize = CRC32C_SIZE;
+		}
+		datagrams = checksumDatagrams_.data();
+	}
+
+	size_t total = 0;
+	for(size_t i = 0; i < count; ++i)
+		total += datagrams[i].headerSize + datagrams[i].payloadSize + datagrams[i].trailerSize;
+
+	std::variant<size_t, UDPError> rc;
+	size_t expected = count;
+	if(destinations_.empty())
+		rc = transmit(datagrams, nullptr, count);
+	else
+	{
+		// Каждая датаграмма размножается на всех адресатов, всё уходит одной пачкой
+		expected = count * destinations_.size();
+		fanoutDatagrams_.clear();
+		fanoutEndpoints_.clear();
+		for(size_t i = 0; i < count; ++i)
+		{
+			for(const Endpoint& destination : destinations_)
+			{
+				fanoutDatagrams_.push_back(datagrams[i]);
+				fanoutEndpoints_.push_back(destination);
+			}
+		}
+		rc = transmit(fanoutDatagrams_.data(), fanoutEndpoints_.data(), expected);
+	}
+
+	if(std::holds_alternative<UDPError>(rc))
+	{
+		std::cerr << udp_error_to_string(std::get<UDPError>(rc)) << std::endl;
+		return -1;
+	}
+	if(std::get<size_t>(rc) != expected)
+	{
+		std::cerr << "UDPTransmitter: only " << std::get<size_t>(rc) << " of " << expected << " datagrams sent" << std::endl;
+		return -1;
+	}
+	for(const Endpoint& destination : destinations_)
+	{
+		if(PeerSession* session = peers_.find(destination))
+		{
+			session->packetsSent += count;
+			session->bytesSent += total;
+		}
+	}
+	return total * (destinations_.empty() ? 1 : destinations_.size());
+}
+
+ssize_t UDPTransmitter::sendProtected(const DatagramView* datagrams, size_t count, FecEncoder& encoder)
+{
+	size_t magicSize = magicString_.length();
+	size_t maxHeader = magicSize + 1;
+	for(size_t i = 0; i < count; ++i)
+		maxHeader = std::max(maxHeader, datagrams[i].headerSize);
+	size_t stride = maxHeader + FecHeader::SIZE;
+	size_t maxViews = count + (count / encoder.k() + 1) * encoder.m();
+	if(fecSendBuf_.size() < maxViews * stride)
+		fecSendBuf_.resize(maxViews * stride);
+	fecDatagrams_.clear();
+
+	size_t total = 0;
+	size_t slot = 0;
+	auto flush = [&]() -> bool
+	{
+		if(fecDatagrams_.empty())
+			return true;
+		ssize_t rc = sendBatch(fecDatagrams_.data(), fecDatagrams_.size());
+		fecDatagrams_.clear();
+		if(rc < 0)
+			return false;
+		total += rc;
+		return true;
+	};
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		const DatagramView& d = datagrams[i];
+		size_t restSize = d.headerSize - magicSize - 1; // заголовки после байта флагов
+		if(d.headerSize - magicSize + d.payloadSize > encoder.maxFrameSize())
+		{
+			fecDatagrams_.push_back(d);
+			continue;
+		}
+
+		uint8_t* header = fecSendBuf_.data() + slot++ * stride;
+		memcpy(header, d.header, magicSize + 1);
+		header[magicSize] |= FRAME_FEC;
+		encoder.dataHeader().write(header + magicSize + 1);
+		memcpy(header + magicSize + 1 + FecHeader::SIZE, d.header + magicSize + 1, restSize);
+		fecDatagrams_.push_back(DatagramView{ header, d.headerSize + FecHeader::SIZE, d.payload, d.payloadSize });
+
+		// Защищается кадр без FEC-заголовка: байт флагов, остальные заголовки и данные
+		bool complete = encoder.add({
+			std::span<const uint8_t>(d.header + magicSize, 1),
+			std::span<const uint8_t>(d.header + magicSize + 1, restSize),
+			std::span<const uint8_t>(d.payload, d.payloadSize) });
+		if(!complete)
+			continue;
+
+		for(uint8_t j = 0; j < encoder.m(); ++j)
+		{
+			uint8_t* parity = fecSendBuf_.data() + slot++ * stride;
+			memcpy(parity, magicString_.c_str(), magicSize);
+			parity[magicSize] = FRAME_FEC | (checksum_ ? FRAME_CHECKSUM : 0);
+			encoder.parityHeader(j).write(parity + magicSize + 1);
+			fecDatagrams_.push_back(DatagramView{ parity, magicSize + 1 + FecHeader::SIZE, encoder.parity(j), encoder.paritySize() });
+		}
+		// parity должны уйти до того, как блок будет сброшен
+		if(!flush())
+			return -1;
+		encoder.nextBlock();
+	}
+	if(!flush())
+		return -1;
+	return total;
+}
+
+ssize_t UDPTransmitter::sendDatagrams(const DatagramView* datagrams, size_t count, FecEncoder* fec)
+{
+	if(fec)
+		return sendProtected(datagrams, count, *fec);
+	return sendBatch(datagrams, count);
+}
+
+ssize_t UDPTransmitter::sendFragments(const uint8_t* payload, size_t payloadSize, uint8_t flags, uint32_t sequence, FecEncoder* fec)
+{
+	size_t magicSize = magicString_.length();
+	size_t headerSize = magicSize + 1 + (sequencing_ ? SEQUENCE_HEADER_SIZE : 0) + FragmentHeader::SIZE;
+	size_t overhead = headerSize + (checksum_ ? CRC32C_SIZE : 0);
+	if(maxDatagramSize_ <= overhead)
+	{
+		std::cerr << udp_error_to_string(UDPError::INVALID_ARGUMENT) << std::endl;
+		return -1;
+	}
+	size_t chunk = std::min<size_t>(maxDatagramSize_ - overhead, UINT16_MAX);
+	size_t count = (payloadSize + chunk - 1) / chunk;
+	if(count > UINT16_MAX)
+	{
+		std::cerr << udp_error_to_string(UDPError::MESSAGE_TOO_LARGE) << std::endl;
+		return -1;
+	}
+
+	if(sendBuf_.size() < count * headerSize)
+		sendBuf_.resize(count * headerSize);
+	datagrams_.resize(count);
+
+	FragmentHeader fragment{ nextMessageId_++, 0, static_cast<uint16_t>(count), static_cast<uint16_t>(chunk) };
+	for(size_t i = 0; i < count; ++i)
+	{
+		uint8_t* header = sendBuf_.data() + i * headerSize;
+		size_t prefix = writeHeader(header, flags | FRAME_FRAGMENT, sequence);
+		fragment.index = static_cast<uint16_t>(i);
+		fragment.write(header + prefix);
+
+		size_t offset = i * chunk;
+		datagrams_[i] = DatagramView{ header, headerSize, payload + offset, std::min(chunk, payloadSize - offset) };
+	}
+	return sendDatagrams(datagrams_.data(), count, fec);
+}
+
+FecEncoder* UDPTransmitter::openStream(PeerSession& session, uint32_t sequence)
+{
+	// sequence — номер сообщения в общем потоке. nextSequence_ растёт с каждым сообщением
+	// и опережает номер любого потока узла, поэтому поток, созданный заново (узел вытеснен
+	// из таблицы) или сменивший общий, не идёт назад и не отбрасывается получателем как
+	// устаревший. Номера блоков FEC берутся из того же счётчика. Кадр общего потока
+	// (широковещание, группа) получают и узлы из таблицы, поэтому их потоки не опускаются
+	// ниже sharedFloor_, иначе следующий адресный кадр будет отброшен как устаревший.
+	if(!session.sendStreamValid)
+	{
+		session.sendStreamValid = true;
+		session.nextSequence = sequence;
+	}
+	if(static_cast<int32_t>(session.nextSequence - sharedFloor_) < 0)
+		session.nextSequence = sharedFloor_;
+	if(!fecEncoder_)
+		return nullptr;
+	FecEncoder& shared = *fecEncoder_;
+	if(!session.fec || session.fec->k() != shared.k() || session.fec->m() != shared.m() || session.fec->maxFrameSize() != shared.maxFrameSize())
+		session.fec = std::make_unique<FecEncoder>(shared.k(), shared.m(), shared.maxFrameSize(), static_cast<uint16_t>(sequence));
+	return session.fec.get();
+}
+
+ssize_t UDPTransmitter::sendMessage(const uint8_t* data, size_t dataSize, uint8_t flags)
+{
+	const uint8_t* payload = data;
+	size_t payloadSize = dataSize;
+	if(compression_ && dataSize >= compressionThreshold_ && dataSize > 0)
+	{
+		// Если выигрыша нет, lzCompress вернёт 0 и данные уйдут как есть
+		if(compressBuf_.size() < dataSize)
+			compressBuf_.resize(dataSize);
+		size_t compressedSize = lzCompress(data, dataSize, compressBuf_.data(), dataSize - 1);
+		if(compressedSize != 0)
+		{
+			payload = compressBuf_.data();
+			payloadSize = compressedSize;
+			flags |= FRAME_COMPRESSED;
+		}
+	}
+
+	// Без нумерации и FEC поток у всех адресатов общий: одна пачка на всех
+	uint32_t sequence = nextSequence_++;
+	bool streams = sequencing_ || fecEncoder_;
+	if(destinations_.empty())
+	{
+		PeerSession* session = nullptr;
+		if(streams && !multicastGroup_.has_value() && target_ != IP_BROADCAST && target_ != IP_ANY)
+			session = peers_.find(Endpoint{ NetAddress(target_), transport().getBindPort() });
+		if(!session)
+		{
+			sharedFloor_ = sequence + 1;
+			return sendFrame(payload, payloadSize, flags, sequence, fecEncoder_.get());
+		}
+		FecEncoder* fec = openStream(*session, sequence);
+		return sendFrame(payload, payloadSize, flags, session->nextSequence++, fec);
+	}
+	if(!streams)
+		return sendFrame(payload, payloadSize, flags, sequence, nullptr);
+
+	// У каждого адресата свои номера и FEC-блоки, поэтому заголовки и parity у них разные
+	// и каждому уходит своя пачка; сжатие выполнено один раз на всех
+	ssize_t total = 0;
+	streamDestinations_.swap(destinations_);
+	for(const Endpoint& destination : streamDestinations_)
+	{
+		PeerSession* found = peers_.find(destination);
+		PeerSession& session = found ? *found : peers_.touch(destination);
+		FecEncoder* fec = openStream(session, sequence);
+		destinations_.assign(1, destination);
+		ssize_t rc = sendFrame(payload, payloadSize, flags, session.nextSequence++, fec);
+		if(rc < 0)
+		{
+			total = -1;
+			break;
+		}
+		total += rc;
+	}
+	destinations_.swap(streamDestinations_);
+	streamDestinations_.clear();
+	return total;
+}
+
+ssize_t UDPTransmitter::sendFrame(const uint8_t* payload, size_t payloadSize, uint8_t flags, uint32_t sequence, FecEncoder* fec)
+{
+	size_t headerSize = magicString_.length() + (extendedHeader_ ? 1 : 0) + (sequencing_ ? SEQUENCE_HEADER_SIZE : 0);
+	if(fragmentation_ && headerSize + payloadSize + (checksum_ ? CRC32C_SIZE : 0) > maxDatagramSize_)
+		return sendFragments(payload, payloadSize, flags, sequence, fec);
+
+	if(sendBuf_.size() < headerSize)
+		sendBuf_.resize(headerSize);
+	writeHeader(sendBuf_.data(), flags, sequence);
+
+	// Заголовок и данные уходят одним sendmsg без копирования в общий буфер
+	DatagramView datagram{ sendBuf_.data(), headerSize, payload, payloadSize };
+	return sendDatagrams(&datagram, 1, fec);
+}
+
+ssize_t UDPTransmitter::flush()
+{
+	if(coalesceSize_ == 0)
+		return 0;
+	size_t size = coalesceSize_;
+	coalesceSize_ = 0;
+	return sendMessage(coalesceBuf_.data(), size, FRAME_BATCH);
+}
+
+ssize_t UDPTransmitter::sendData(const uint8_t* data, size_t dataSize)
+{
+	if(!coalescing_ || !destinations_.empty())
+		return sendMessage(data, dataSize, 0);
+
+	// Место под сообщения: предел датаграммы без заголовков и контрольной суммы
+	size_t overhead = magicString_.length() + 1 + (sequencing_ ? SEQUENCE_HEADER_SIZE : 0) +
+		(checksum_ ? CRC32C_SIZE : 0) + (fecEncoder_ ? FecHeader::SIZE : 0);
+	size_t capacity = coalesceLimit_ > overhead ? coalesceLimit_ - overhead : 0;
+	size_t recordSize = varintSize(dataSize) + dataSize;
+	if(recordSize > capacity) // крупное сообщение уходит отдельно, после накопленных
+	{
+		if(flush() < 0)
+			return -1;
+		return sendMessage(data, dataSize, 0);
+	}
+	if(coalesceSize_ + recordSize > capacity && flush() < 0)
+		return -1;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if(coalesceSize_ == 0)
+		coalesceStarted_ = now;
+	if(coalesceBuf_.size() < capacity)
+		coalesceBuf_.resize(capacity);
+	coalesceSize_ += writeVarint(coalesceBuf_.data() + coalesceSize_, dataSize);
+	if(dataSize > 0)
+		memcpy(coalesceBuf_.data() + coalesceSize_, data, dataSize);
+	coalesceSize_ += dataSize;
+
+	if(now - coalesceStarted_ >= coalesceDeadline_ && flush() < 0)
+		return -1;
+	return dataSize;
+}
+
+ssize_t UDPTransmitter::sendDataTo(const Endpoint& peer, const uint8_t* data, size_t dataSize)
+{
+	if(flush() < 0)
+		return -1;
+	destinations_.assign(1, peer);
+	ssize_t rc = sendData(data, dataSize);
+	destinations_.clear();
+	return rc;
+}
+
+ssize_t UDPTransmitter::sendDataToAll(const uint8_t* data, size_t dataSize)
+{
+	if(flush() < 0)
+		return -1;
+	destinations_.clear();
+	peers_.forEach([&](const PeerSession& session) { destinations_.push_back(session.endpoint); });
+	if(destinations_.empty())
+		return 0;
+	ssize_t rc = sendData(data, dataSize);
+	destinations_.clear();
+	return rc;
+}
+
+std::variant<ReceiveInfo, UDPError> UDPTransmitter::receiveDatagram(uint8_t* buffer, size_t maxSize, const uint8_t*& data)
+{
+	data = buffer;
+	if(replay_)
+	{
+		if(replaySpeed_ > 0)
+		{
+			std::optional<std::chrono::system_clock::time_point> due = replay_->peekTimestamp();
+			if(!due.has_value())
+				return RECEIVE_NONE;
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if(!replayOrigin_.has_value())
+			{
+				replayOrigin_ = due;
+				replayStarted_ = now;
+			}
+			std::chrono::duration<double> offset = (due.value() - replayOrigin_.value()) / replaySpeed_;
+			if(now - replayStarted_ < offset)
+				return RECEIVE_NONE;
+		}
+		std::optional<CaptureRecord> record = replay_->next();
+		if(!record.has_value())
+			return RECEIVE_NONE;
+		// Данные читаются прямо из отображения файла, без копирования
+		data = record->data;
+		return ReceiveInfo(std::min(record->size, maxSize), record->peer.ip.toV4(), record->peer.port, record->peer.ip);
+	}
+
+	std::variant<ReceiveInfo, UDPError> rc = transport().recieve(buffer, maxSize);
+	if(capture_ && std::holds_alternative<ReceiveInfo>(rc))
+	{
+		const ReceiveInfo& info = std::get<ReceiveInfo>(rc);
+		if(recieved(info))
+			capture_->write(info, buffer);
+	}
+	return rc;
+}
+
+ReceiveInfo UDPTransmitter::receiveLegacy(uint8_t* buffer, size_t maxSize, bool* socketEmpty)
+{
+	const uint8_t* data;
+	std::variant<ReceiveInfo, UDPError> rc = receiveDatagram(buffer, maxSize, data);
+	if(std::holds_alternative<UDPError>(rc))
+	{
+		std::cerr << udp_error_to_string(std::get<UDPError>(rc)) << std::endl;
+		if(socketEmpty)
+			*socketEmpty = true;
+		return ReceiveInfo(0, std::nullopt);
+	}
+	ReceiveInfo info = std::get<ReceiveInfo>(rc);
+	if(socketEmpty)
+		*socketEmpty = wouldBlock(info);
+	if(!recieved(info))
+		return RECEIVE_NONE;
+	if(!checkMagic(data, info.dataSize))
+	{
+		++drops_.foreign;
+		return RECEIVE_NONE;
+	}
+	if(!filterSender(info))
+		return RECEIVE_NONE;
+	if(!acceptSender(info.remoteIP))
+	{
+		++drops_.rejected;
+		return RECEIVE_NONE;
+	}
+	PeerSession& session = peers_.touch(info.remoteEndpoint());
+	++session.packetsReceived;
+	session.bytesReceived += info.dataSize;
+	size_t new_size = info.dataSize - magicString_.length();
+	memmove(buffer, data + magicString_.length(), new_size);
+	return info.withSize(new_size);
+}
+
+ReceiveInfo UDPTransmitter::deliverBatched(uint8_t* buffer, size_t maxSize)
+{
+	if(batchRead_ >= batchSize_)
+		return RECEIVE_NONE;
+	const uint8_t* in = batchBuf_.data() + batchRead_;
+	const uint8_t* end = batchBuf_.data() + batchSize_;
+	uint64_t length;
+	if(!readVarint(in, end, length) || length > static_cast<size_t>(end - in))
+	{
+		++drops_.malformed;
+		batchRead_ = batchSize_;
+		return RECEIVE_NONE;
+	}
+	batchRead_ = in + length - batchBuf_.data();
+	size_t size = length < maxSize ? length : maxSize;
+	if(size > 0)
+		memcpy(buffer, in, size);
+	return batchInfo_.withSize(size);
+}
+
+ReceiveInfo UDPTransmitter::deliverPayload(uint8_t flags, const uint8_t* payload, size_t payloadSize, ReceiveInfo info, uint8_t* buffer, size_t maxSize)
+{
+	if(flags & FRAME_BATCH)
+	{
+		// Склеенные сообщения раскладываются во внутренний буфер и отдаются по одному
+		if(batchBuf_.size() < MAX_DATAGRAM_SIZE)
+			batchBuf_.resize(MAX_DATAGRAM_SIZE);
+		if(flags & FRAME_COMPRESSED)
+		{
+			std::optional<size_t> size = lzDecompress(payload, payloadSize, batchBuf_.data(), batchBuf_.size());
+			if(!size.has_value())
+			{
+				++drops_.malformed;
+				return RECEIVE_NONE;
+			}
+			batchSize_ = size.value();
+		}
+		else
+		{
+			if(batchBuf_.size() < payloadSize)
+				batchBuf_.resize(payloadSize);
+			memcpy(batchBuf_.data(), payload, payloadSize);
+			batchSize_ = payloadSize;
+		}
+		batchRead_ = 0;
+		batchInfo_ = info;
+		batchInfo_.sequence.reset(); // у записей пакета нет своих номеров
+		return deliverBatched(buffer, maxSize);
+	}
+
+	if(flags & FRAME_COMPRESSED)
+	{
+		// Распаковываем напрямую в буфер пользователя
+		std::optional<size_t> size = lzDecompress(payload, payloadSize, buffer, maxSize);
+		if(!size.has_value())
+		{
+			++drops_.malformed;
+			return RECEIVE_NONE;
+		}
+		return info.withSize(size.value());
+	}
+
+	size_t size = payloadSize < maxSize ? payloadSize : maxSize;
+	memcpy(buffer, payload, size);
+	return info.withSize(size);
+}
+
+ReceiveInfo UDPTransmitter::processFrame(uint8_t flags, const uint8_t* payload, size_t payloadSize, ReceiveInfo info, uint8_t* buffer, size_t maxSize)
+{
+	flags &= ~FRAME_CHECKSUM; // сумма уже проверена в processDatagram, у восстановленных кадров её нет
+
+	std::optional<uint32_t> sequence;
+	if(flags & FRAME_SEQUENCE)
+	{
+		if(payloadSize < SEQUENCE_HEADER_SIZE)
+		{
+			++drops_.malformed;
+			return RECEIVE_NONE;
+		}
+		uint32_t net;
+		memcpy(&net, payload, sizeof(net));
+		sequence = ntoh(net);
+		payload += SEQUENCE_HEADER_SIZE;
+		payloadSize -= SEQUENCE_HEADER_SIZE;
+		flags &= ~FRAME_SEQUENCE;
+	}
+
+	if(flags & FRAME_FRAGMENT)
+	{
+		if(!reassembly_ || payloadSize < FragmentHeader::SIZE)
+		{
+			++drops_.malformed;
+			return RECEIVE_NONE;
+		}
+		FragmentHeader fragment = FragmentHeader::read(payload);
+		std::optional<ReassembledMessage> message = reassembly_->insert(info.remoteEndpoint(),
+			flags & ~FRAME_FRAGMENT, fragment, payload + FragmentHeader::SIZE, payloadSize - FragmentHeader::SIZE);
+		if(!message.has_value())
+			return RECEIVE_NONE;
+		flags = message->flags;
+		payload = message->data;
+		payloadSize = message->size;
+	}
+
+	// Номер проверяется у целого сообщения, после сборки фрагментов
+	if(sequence.has_value() && !acceptSequence(info.remoteEndpoint(), sequence.value()))
+		return RECEIVE_NONE;
+	info.sequence = sequence;
+	deliveredSequence_ = sequence;
+
+	return deliverPayload(flags, payload, payloadSize, info, buffer, maxSize);
+}
+
+ReceiveInfo UDPTransmitter::deliverRecovered(uint8_t* buffer, size_t maxSize)
+{
+	while(std::optional<FecRecoveredFrame> frame = fecDecoder_->popRecovered())
+	{
+		if(frame->size < 1)
+			continue;
+		uint8_t flags = frame->data[0];
+		if((flags & ~FRAME_KNOWN_FLAGS) || (flags & (FRAME_FEC | FRAME_CONTROL)))
+			continue;
+		ReceiveInfo rc = processFrame(flags, frame->data + 1, frame->size - 1, ReceiveInfo(0, frame->peer.ip.toV4(), frame->peer.port, frame->peer.ip), buffer, maxSize);
+		if(recieved(rc))
+			return rc;
+	}
+	return RECEIVE_NONE;
+}
+
+ReceiveInfo UDPTransmitter::processDatagram(const uint8_t* data, size_t size, ReceiveInfo info, uint8_t* buffer, size_t maxSize)
+{
+	size_t magicSize = magicString_.length();
+	if(size < magicSize + 1 || !checkMagic(data, size))
+	{
+		++drops_.foreign;
+		return RECEIVE_NONE;
+	}
+
+	uint8_t flags = data[magicSize];
+	if(flags & ~FRAME_KNOWN_FLAGS)
+	{
+		++drops_.malformed;
+		return RECEIVE_NONE;
+	}
+	if(flags & FRAME_CHECKSUM)
+	{
+		// Проверяем до acceptSender, чтобы повреждённый пакет не сменил target_
+		if(size < magicSize + 1 + CRC32C_SIZE)
+		{
+			++drops_.malformed;
+			return RECEIVE_NONE;
+		}
+		size -= CRC32C_SIZE;
+		uint32_t expected;
+		memcpy(&expected, data + size, CRC32C_SIZE);
+		if(crc32c(data, size) != ntoh(expected))
+		{
+			++drops_.corrupted;
+			return RECEIVE_NONE;
+		}
+	}
+	if(!filterSender(info))
+		return RECEIVE_NONE;
+	// Служебные кадры не меняют адресата. При закреплённом адресате они принимаются ещё
+	// от исходного и резервных адресатов (иначе их живость не была бы известна), от прочих
+	// отбрасываются, не попадая в таблицу узлов
+	if(flags & FRAME_CONTROL)
+	{
+		if(!acceptControlSender(info.remoteIP))
+		{
+			++drops_.rejected;
+			return RECEIVE_NONE;
+		}
+		restorePrimary(info.remoteIP);
+	}
+	else if(!acceptSender(info.remoteIP))
+	{
+		++drops_.rejected;
+		return RECEIVE_NONE;
+	}
+	Endpoint peer = info.remoteEndpoint();
+	PeerSession& session = peers_.touch(peer);
+	++session.packetsReceived;
+	session.bytesReceived += size;
+	if(heartbeat_)
+		watchPeer(session);
+
+	const uint8_t* payload = data + magicSize + 1;
+	size_t payloadSize = size - magicSize - 1;
+
+	if(flags & FRAME_CONTROL)
+	{
+		if(flags & ~(FRAME_CONTROL | FRAME_CHECKSUM))
+			++drops_.malformed;
+		else
+			handleControlFrame(payload, payloadSize, peer, session.lastSeen);
+		return RECEIVE_NONE;
+	}
+
+	if(flags & FRAME_FEC)
+	{
+		if(!fecDecoder_ || payloadSize < FecHeader::SIZE)
+		{
+			++drops_.malformed;
+			return RECEIVE_NONE;
+		}
+		FecHeader fec = FecHeader::read(payload);
+		payload += FecHeader::SIZE;
+		payloadSize -= FecHeader::SIZE;
+		flags &= ~FRAME_FEC;
+
+		if(fec.index >= fec.k) // parity-кадр: только сохраняем и пробуем восстановить потери
+		{
+			if((flags & ~FRAME_CHECKSUM) != 0)
+			{
+				++drops_.malformed;
+				return RECEIVE_NONE;
+			}
+			fecDecoder_->add(peer, fec, { std::span<const uint8_t>(payload, payloadSize) });
+			return deliverRecovered(buffer, maxSize);
+		}
+		if(!fecDecoder_->add(peer, fec, { std::span<const uint8_t>(&flags, 1), std::span<const uint8_t>(payload, payloadSize) }))
+			return RECEIVE_NONE; // уже восстановлен по parity
+	}
+
+	return processFrame(flags, payload, payloadSize, info, buffer, maxSize);
+}
+
+ReceiveInfo UDPTransmitter::receiveImpl(uint8_t* buffer, size_t maxSize, bool* socketEmpty)
+{
+	if(coalesceSize_ > 0 || clockSync_ || heartbeat_ || reassembly_ || pacedHead_ < paced_.size())
+		serviceTimers(std::chrono::steady_clock::now());
+
+	if(!extendedHeader_)
+		return receiveLegacy(buffer, maxSize, socketEmpty);
+
+	if(socketEmpty)
+		*socketEmpty = false;
+
+	if(batchRead_ < batchSize_)
+	{
+		ReceiveInfo batched = deliverBatched(buffer, maxSize);
+		if(recieved(batched))
+			return batched;
+	}
+
+	if(fecDecoder_)
+	{
+		ReceiveInfo recovered = deliverRecovered(buffer, maxSize);
+		if(recieved(recovered))
+			return recovered;
+	}
+
+	if(recvBuf_.size() < MAX_DATAGRAM_SIZE)
+		recvBuf_.resize(MAX_DATAGRAM_SIZE);
+
+	const uint8_t* data;
+	std::variant<ReceiveInfo, UDPError> rc = receiveDatagram(recvBuf_.data(), recvBuf_.size(), data);
+	if(std::holds_alternative<UDPError>(rc))
+	{
+		std::cerr << udp_error_to_string(std::get<UDPError>(rc)) << std::endl;
+		if(socketEmpty)
+			*socketEmpty = true;
+		return ReceiveInfo(0, std::nullopt);
+	}
+	ReceiveInfo info = std::get<ReceiveInfo>(rc);
+	if(!recieved(info))
+	{
+		if(socketEmpty)
+			*socketEmpty = wouldBlock(info); // отфильтрованная транспортом датаграмма — не конец очереди
+		return RECEIVE_NONE;
+	}
+	return processDatagram(data, info.dataSize, info, buffer, maxSize);
+}
+
+ReceiveInfo UDPTransmitter::receiveData(uint8_t* buffer, size_t maxSize)
+{
+	return receiveImpl(buffer, maxSize, nullptr);
+}
+
+ReceiveInfo UDPTransmitter::receiveLatest(uint8_t* buffer, size_t maxSize)
+{
+	// Принимаем попеременно в buffer и latestBuf_, чтобы не затереть лучший кадр
+	// неудачным приёмом; в конце копируем не больше одного раза
+	if(latestBuf_.size() < maxSize)
+		latestBuf_.resize(maxSize);
+	uint8_t* buffers[2] = { buffer, latestBuf_.data() };
+	size_t current = 0;
+	size_t best = 0;
+	ReceiveInfo latest = RECEIVE_NONE;
+	std::optional<uint32_t> latestSequence;
+
+	for(size_t i = 0; i < MAX_DRAIN; ++i)
+	{
+		bool socketEmpty = false;
+		ReceiveInfo rc = receiveImpl(buffers[current], maxSize, &socketEmpty);
+		if(recieved(rc))
+		{
+			// Записи пакета получают номер его кадра: более поздняя запись того же кадра новее
+			std::optional<uint32_t> sequence = deliveredSequence_;
+			if(recieved(latest) && sequence.has_value() && latestSequence.has_value() &&
+				rc.remoteEndpoint() == latest.remoteEndpoint() &&
+				static_cast<int32_t>(sequence.value() - latestSequence.value()) < 0)
+				continue; // устаревшее сообщение того же узла
+			latest = rc;
+			latestSequence = sequence;
+			best = current;
+			current ^= 1;
+		}
+		else if(socketEmpty)
+			break;
+	}
+
+	if(recieved(latest) && best == 1)
+		memcpy(buffer, latestBuf_.data(), latest.dataSize);
+	return latest;
+}
@@ -0,0 +1,606 @@
+#include <xdpTransport.h>
+
+#include <linux/if_xdp.h>
+#include <linux/if_link.h>
+#include <linux/if_ether.h>
+#include <linux/bpf.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <atomic>
+#include <bit>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+	constexpr size_t ETH_HEADER = 14;
+	constexpr size_t IP_HEADER = 20;
+	constexpr size_t UDP_HEADER = 8;
+	constexpr size_t HEADERS = ETH_HEADER + IP_HEADER + UDP_HEADER;
+	constexpr size_t MAX_MAGIC = 32;
+	// Адрес без записи ARP не ищется в /proc/net/arp повторно, пока не истёк срок
+	constexpr std::chrono::seconds UNRESOLVED_TTL{ 1 };
+	constexpr size_t MAX_UNRESOLVED = 1024;
+
+	const std::string CONSTRUCTOR = "XdpTransport::XdpTransport(const XdpConfig&) ";
+
+	[[noreturn]] void fail(const std::string& what)
+	{
+		throw std::runtime_error(CONSTRUCTOR + what + ": " + strerror(errno));
+	}
+
+	int bpf(int cmd, bpf_attr& attr)
+	{
+		return static_cast<int>(syscall(__NR_bpf, cmd, &attr, sizeof(attr)));
+	}
+
+	// Индексы колец разделены с ядром: свой пишем с release, чужой читаем с acquire
+	uint32_t loadAcquire(uint32_t* index)
+	{
+		return std::atomic_ref<uint32_t>(*index).load(std::memory_order_acquire);
+	}
+
+	void storeRelease(uint32_t* index, uint32_t value)
+	{
+		std::atomic_ref<uint32_t>(*index).store(value, std::memory_order_release);
+	}
+
+	// Значение, которое BPF-программа прочитает из пакета по этим байтам (порядок байт хоста)
+	template<typename T>
+	int32_t raw(const uint8_t* bytes)
+	{
+		T value;
+		memcpy(&value, bytes, sizeof(T));
+		return static_cast<int32_t>(value);
+	}
+
+	bpf_insn insn(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm)
+	{
+		bpf_insn result{};
+		result.code = code;
+		result.dst_reg = dst;
+		result.src_reg = src;
+		result.off = off;
+		result.imm = imm;
+		return result;
+	}
+
+	uint16_t ipChecksum(const uint8_t* header)
+	{
+		uint32_t sum = 0;
+		for(size_t i = 0; i < IP_HEADER; i += 2)
+			sum += (header[i] << 8) | header[i + 1];
+		while(sum >> 16)
+			sum = (sum & 0xFFFF) + (sum >> 16);
+		return static_cast<uint16_t>(~sum);
+	}
+
+	void putU16(uint8_t* out, uint16_t value) // big-endian
+	{
+		out[0] = static_cast<uint8_t>(value >> 8);
+		out[1] = static_cast<uint8_t>(value);
+	}
+
+	uint16_t getU16(const uint8_t* in)
+	{
+		return static_cast<uint16_t>((in[0] << 8) | in[1]);
+	}
+}
+
+XdpTransport::XdpTransport(const XdpConfig& config) :
+config_(config)
+{
+	if(config_.port == 0)
+		throw std::invalid_argument(CONSTRUCTOR + "port is required");
+	if(config_.frameSize != 2048 && config_.frameSize != 4096)
+		throw std::invalid_argument(CONSTRUCTOR + "frameSize must be 2048 or 4096");
+	if(config_.frameCount < 4 || !std::has_single_bit(config_.frameCount))
+		throw std::invalid_argument(CONSTRUCTOR + "frameCount must be a power of two, at least 4");
+	if(config_.magic.size() > MAX_MAGIC)
+		throw std::invalid_argument(CONSTRUCTOR + "magic is longer than 32 bytes");
+	if(config_.zeroCopy && config_.mode == XdpMode::GENERIC)
+		throw std::invalid_argument(CONSTRUCTOR + "zero-copy requires native mode");
+
+	try
+	{
+		setup();
+	}
+	catch(...)
+	{
+		release();
+		throw;
+	}
+}
+
+XdpTransport::~XdpTransport()
+{
+	release();
+}
+
+void XdpTransport::release()
+{
+	if(linkFd_ >= 0) // закрытие связи снимает программу с интерфейса
+		close(linkFd_);
+	if(progFd_ >= 0)
+		close(progFd_);
+	if(mapFd_ >= 0)
+		close(mapFd_);
+	for(Ring* ring : { &fill_, &completion_, &rx_, &tx_ })
+		if(ring->map)
+			munmap(ring->map, ring->mapSize);
+	if(socket_ >= 0)
+		close(socket_);
+	if(umem_)
+		munmap(umem_, umemSize_);
+	linkFd_ = progFd_ = mapFd_ = socket_ = -1;
+	umem_ = nullptr;
+}
+
+void XdpTransport::mapRing(Ring& ring, const xdp_ring_offset& offsets, uint64_t pageOffset, size_t descSize)
+{
+	ring.mapSize = offsets.desc + ring.size * descSize;
+	void* map = mmap(nullptr, ring.mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, socket_, static_cast<off_t>(pageOffset));
+	if(map == MAP_FAILED)
+		fail("mmap ring");
+	uint8_t* base = static_cast<uint8_t*>(map);
+	ring.map = map;
+	ring.producer = reinterpret_cast<uint32_t*>(base + offsets.producer);
+	ring.consumer = reinterpret_cast<uint32_t*>(base + offsets.consumer);
+	ring.flags = reinterpret_cast<uint32_t*>(base + offsets.flags);
+	ring.descs = base + offsets.desc;
+	ring.mask = ring.size - 1;
+}
+
+void XdpTransport::setup()
+{
+	ifindex_ = static_cast<int>(if_nametoindex(config_.interfaceName.c_str()));
+	if(ifindex_ == 0)
+		fail("interface " + config_.interfaceName);
+	port_ = htons(config_.port);
+
+	// Свой адрес и широковещательный адрес подсети
+	ifaddrs* addrs = nullptr;
+	if(getifaddrs(&addrs) != 0)
+		fail("getifaddrs");
+	for(ifaddrs* ifa = addrs; ifa; ifa = ifa->ifa_next)
+	{
+		if(!ifa->ifa_addr || ifa->ifa_addr->sa_family != AF_INET || config_.interfaceName != ifa->ifa_name)
+			continue;
+		uint32_t address = reinterpret_cast<sockaddr_in*>(ifa->ifa_addr)->sin_addr.s_addr;
+		if(config_.ip != IP_ANY && config_.ip.toNet() != address)
+			continue;
+		ip_ = address;
+		if((ifa->ifa_flags & IFF_BROADCAST) && ifa->ifa_broadaddr)
+			broadcast_ = reinterpret_cast<sockaddr_in*>(ifa->ifa_broadaddr)->sin_addr.s_addr;
+		break;
+	}
+	freeifaddrs(addrs);
+	if(ip_ == 0)
+		ip_ = config_.ip.toNet(); // адрес ещё не назначен интерфейсу — принимаем на заданный
+
+	ifreq request{};
+	strncpy(request.ifr_name, config_.interfaceName.c_str(), IFNAMSIZ - 1);
+	int query = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	int queried = query < 0 ? -1 : ioctl(query, SIOCGIFHWADDR, &request);
+	if(query >= 0)
+		close(query);
+	if(queried != 0)
+		fail("SIOCGIFHWADDR");
+	memcpy(mac_.data(), request.ifr_hwaddr.sa_data, 6);
+
+	socket_ = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+	if(socket_ < 0)
+		fail("socket(AF_XDP)");
+
+	// UMEM: первая половина кадров — приём (кольцо fill), вторая — отправка
+	umemSize_ = static_cast<size_t>(config_.frameCount) * config_.frameSize;
+	void* umem = mmap(nullptr, umemSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(umem == MAP_FAILED)
+		fail("mmap UMEM");
+	umem_ = static_cast<uint8_t*>(umem);
+
+	xdp_umem_reg reg{};
+	reg.addr = reinterpret_cast<uint64_t>(umem_);
+	reg.len = umemSize_;
+	reg.chunk_size = config_.frameSize;
+	if(setsockopt(socket_, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) != 0)
+		fail("XDP_UMEM_REG");
+
+	uint32_t ringSize = config_.frameCount / 2;
+	fill_.size = completion_.size = rx_.size = tx_.size = ringSize;
+	if(setsockopt(socket_, SOL_XDP, XDP_UMEM_FILL_RING, &ringSize, sizeof(ringSize)) != 0
+		|| setsockopt(socket_, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ringSize, sizeof(ringSize)) != 0
+		|| setsockopt(socket_, SOL_XDP, XDP_RX_RING, &ringSize, sizeof(ringSize)) != 0
+		|| setsockopt(socket_, SOL_XDP, XDP_TX_RING, &ringSize, sizeof(ringSize)) != 0)
+		fail("ring setup");
+
+	xdp_mmap_offsets offsets{};
+	socklen_t offsetsSize = sizeof(offsets);
+	if(getsockopt(socket_, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &offsetsSize) != 0)
+		fail("XDP_MMAP_OFFSETS");
+	mapRing(fill_, offsets.fr, XDP_UMEM_PGOFF_FILL_RING, sizeof(uint64_t));
+	mapRing(completion_, offsets.cr, XDP_UMEM_PGOFF_COMPLETION_RING, sizeof(uint64_t));
+	mapRing(rx_, offsets.rx, XDP_PGOFF_RX_RING, sizeof(xdp_desc));
+	mapRing(tx_, offsets.tx, XDP_PGOFF_TX_RING, sizeof(xdp_desc));
+
+	uint64_t* fillAddrs = static_cast<uint64_t*>(fill_.descs);
+	for(uint32_t i = 0; i < ringSize; ++i)
+		fillAddrs[i] = static_cast<uint64_t>(i) * config_.frameSize;
+	storeRelease(fill_.producer, ringSize);
+	freeFrames_.reserve(ringSize);
+	for(uint32_t i = 0; i < ringSize; ++i)
+		freeFrames_.push_back(static_cast<uint64_t>(ringSize + i) * config_.frameSize);
+
+	sockaddr_xdp address{};
+	address.sxdp_family = AF_XDP;
+	address.sxdp_ifindex = static_cast<uint32_t>(ifindex_);
+	address.sxdp_queue_id = config_.queue;
+	address.sxdp_flags = (config_.zeroCopy ? XDP_ZEROCOPY : XDP_COPY) | XDP_USE_NEED_WAKEUP;
+	if(::bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+		fail("bind AF_XDP to " + config_.interfaceName + " queue " + std::to_string(config_.queue));
+
+	bpf_attr attr{};
+	attr.map_type = BPF_MAP_TYPE_XSKMAP;
+	attr.key_size = sizeof(uint32_t);
+	attr.value_size = sizeof(uint32_t);
+	attr.max_entries = config_.queue + 1;
+	mapFd_ = bpf(BPF_MAP_CREATE, attr);
+	if(mapFd_ < 0)
+		fail("BPF_MAP_CREATE");
+
+	uint32_t key = config_.queue;
+	uint32_t value = static_cast<uint32_t>(socket_);
+	attr = {};
+	attr.map_fd = static_cast<uint32_t>(mapFd_);
+	attr.key = reinterpret_cast<uint64_t>(&key);
+	attr.value = reinterpret_cast<uint64_t>(&value);
+	if(bpf(BPF_MAP_UPDATE_ELEM, attr) != 0)
+		fail("BPF_MAP_UPDATE_ELEM");
+
+	progFd_ = loadProgram();
+	attachProgram();
+}
+
+// XDP-программа: IPv4 без опций и фрагментации, UDP на наш порт (и адрес, и magic) —
+// в сокет очереди через XSKMAP, всё остальное — в стек ядра (XDP_PASS)
+int XdpTransport::loadProgram()
+{
+	std::vector<bpf_insn> program;
+	std::vector<size_t> toPass; // переходы на XDP_PASS, смещения проставляются в конце
+	auto jumpToPass = [&](uint8_t code, uint8_t reg, int32_t imm)
+	{
+		toPass.push_back(program.size());
+		program.push_back(insn(code, reg, 0, 0, imm));
+	};
+	auto load = [&](uint8_t size, int16_t offset) // r4 = *(size*)(r2 + offset)
+	{
+		program.push_back(insn(BPF_LDX | BPF_MEM | size, BPF_REG_4, BPF_REG_2, offset, 0));
+	};
+
+	uint8_t header[HEADERS]{};
+	header[12] = 0x08; // ETH_P_IP
+	putU16(header + 20, 0x3FFF); // флаг MF и смещение фрагмента
+	memcpy(header + 36, &port_, 2);
+
+	program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0));
+	program.push_back(insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_1, offsetof(xdp_md, data), 0));
+	program.push_back(insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_1, offsetof(xdp_md, data_end), 0));
+	program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0));
+	program.push_back(insn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, static_cast<int32_t>(HEADERS + config_.magic.size())));
+	toPass.push_back(program.size());
+	program.push_back(insn(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0, 0));
+
+	load(BPF_H, 12);
+	jumpToPass(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_4, raw<uint16_t>(header + 12));
+	load(BPF_B, 14);
+	jumpToPass(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_4, 0x45);
+	load(BPF_B, 23);
+	jumpToPass(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_4, IPPROTO_UDP);
+	load(BPF_H, 20);
+	program.push_back(insn(BPF_ALU | BPF_AND | BPF_K, BPF_REG_4, 0, 0, raw<uint16_t>(header + 20)));
+	jumpToPass(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_4, 0);
+	if(config_.ip != IP_ANY) // свой адрес или широковещание
+	{
+		load(BPF_W, 30);
+		std::vector<size_t> accepted;
+		for(uint32_t address : { ip_, IP_BROADCAST.toNet(), broadcast_ })
+		{
+			if(address == 0)
+				continue;
+			accepted.push_back(program.size());
+			program.push_back(insn(BPF_JMP32 | BPF_JEQ | BPF_K, BPF_REG_4, 0, 0, raw<uint32_t>(reinterpret_cast<const uint8_t*>(&address))));
+		}
+		jumpToPass(BPF_JMP | BPF_JA, 0, 0);
+		for(size_t jump : accepted)
+			program[jump].off = static_cast<int16_t>(program.size() - jump - 1);
+	}
+	load(BPF_H, 36);
+	jumpToPass(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_4, raw<uint16_t>(header + 36));
+	for(size_t i = 0; i < config_.magic.size(); ++i)
+	{
+		load(BPF_B, static_cast<int16_t>(HEADERS + i));
+		jumpToPass(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_4, static_cast<uint8_t>(config_.magic[i]));
+	}
+
+	// bpf_redirect_map(&xsks, ctx->rx_queue_index, XDP_PASS)
+	program.push_back(insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, offsetof(xdp_md, rx_queue_index), 0));
+	program.push_back(insn(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, mapFd_));
+	program.push_back(insn(0, 0, 0, 0, 0));
+	program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS));
+	program.push_back(insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map));
+	program.push_back(insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+	size_t pass = program.size();
+	program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS));
+	program.push_back(insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+	for(size_t jump : toPass)
+		program[jump].off = static_cast<int16_t>(pass - jump - 1);
+
+	static const char license[] = "Dual MIT/GPL";
+	char log[4096] = {};
+	bpf_attr attr{};
+	attr.prog_type = BPF_PROG_TYPE_XDP;
+	attr.insns = reinterpret_cast<uint64_t>(program.data());
+	attr.insn_cnt = static_cast<uint32_t>(program.size());
+	attr.license = reinterpret_cast<uint64_t>(license);
+	attr.log_buf = reinterpret_cast<uint64_t>(log);
+	attr.log_size = sizeof(log);
+	attr.log_level = 1;
+	int fd = bpf(BPF_PROG_LOAD, attr);
+	if(fd < 0)
+		fail(std::string("BPF_PROG_LOAD ") + log);
+	return fd;
+}
+
+void XdpTransport::attachProgram()
+{
+	bpf_attr attr{};
+	attr.link_create.prog_fd = static_cast<uint32_t>(progFd_);
+	attr.link_create.target_ifindex = static_cast<uint32_t>(ifindex_);
+	attr.link_create.attach_type = BPF_XDP;
+	attr.link_create.flags = config_.mode == XdpMode::GENERIC ? XDP_FLAGS_SKB_MODE : XDP_FLAGS_DRV_MODE;
+	linkFd_ = bpf(BPF_LINK_CREATE, attr);
+	if(linkFd_ < 0)
+		fail("attach XDP program to " + config_.interfaceName);
+}
+
+// MAC получателя: широковещание и multicast вычисляются, остальные — из принятых
+// пакетов, заданных вручную или таблицы соседей ядра
+bool XdpTransport::resolve(uint32_t ip, uint8_t* mac)
+{
+	const uint8_t* octets = reinterpret_cast<const uint8_t*>(&ip);
+	if(ip == IP_BROADCAST.toNet() || (broadcast_ != 0 && ip == broadcast_))
+	{
+		memset(mac, 0xFF, 6);
+		return true;
+	}
+	if((octets[0] & 0xF0) == 0xE0)
+	{
+		const uint8_t group[6] = { 0x01, 0x00, 0x5E, static_cast<uint8_t>(octets[1] & 0x7F), octets[2], octets[3] };
+		memcpy(mac, group, 6);
+		return true;
+	}
+	auto it = neighbours_.find(ip);
+	if(it != neighbours_.end())
+	{
+		memcpy(mac, it->second.data(), 6);
+		return true;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	auto miss = unresolved_.find(ip);
+	if(miss != unresolved_.end())
+	{
+		if(now < miss->second)
+			return false;
+		unresolved_.erase(miss);
+	}
+
+	// IP address | HW type | Flags | HW address | Mask | Device
+	std::ifstream arp("/proc/net/arp");
+	std::string line;
+	std::getline(arp, line);
+	while(std::getline(arp, line))
+	{
+		std::istringstream fields(line);
+		std::string address, type, flags, hardware, mask, device;
+		if(!(fields >> address >> type >> flags >> hardware >> mask >> device))
+			continue;
+		std::optional<IPAddress> parsed = IPAddress::fromString(address);
+		if(device != config_.interfaceName || !parsed || parsed->toNet() != ip || flags == "0x0")
+			continue;
+		std::array<uint8_t, 6> entry{};
+		unsigned int bytes[6];
+		if(sscanf(hardware.c_str(), "%x:%x:%x:%x:%x:%x", &bytes[0], &bytes[1], &bytes[2], &bytes[3], &bytes[4], &bytes[5]) != 6)
+			continue;
+		for(size_t i = 0; i < 6; ++i)
+			entry[i] = static_cast<uint8_t>(bytes[i]);
+		neighbours_[ip] = entry;
+		memcpy(mac, entry.data(), 6);
+		return true;
+	}
+	if(unresolved_.size() >= MAX_UNRESOLVED)
+		std::erase_if(unresolved_, [now](const auto& entry) { return entry.second <= now; });
+	if(unresolved_.size() < MAX_UNRESOLVED)
+		unresolved_[ip] = now + UNRESOLVED_TTL;
+	return false;
+}
+
+// Отправленные кадры возвращаются через кольцо completion
+void XdpTransport::reclaim()
+{
+	uint32_t producer = loadAcquire(completion_.producer);
+	uint32_t consumer = *completion_.consumer;
+	const uint64_t* addrs = static_cast<const uint64_t*>(completion_.descs);
+	for(; consumer != producer; ++consumer)
+		freeFrames_.push_back(addrs[consumer & completion_.mask]);
+	storeRelease(completion_.consumer, consumer);
+}
+
+void XdpTransport::kickTx()
+{
+	// в режиме копирования отправку выполняет сам системный вызов
+	if(config_.mode == XdpMode::GENERIC || (loadAcquire(tx_.flags) & XDP_RING_NEED_WAKEUP))
+		sendto(socket_, nullptr, 0, MSG_DONTWAIT, nullptr, 0);
+}
+
+std::variant<size_t, UDPError> XdpTransport::send(const DatagramView* datagrams, const Endpoint* destinations, size_t count, IPAddress ip)
+{
+	reclaim();
+	uint32_t producer = *tx_.producer;
+	xdp_desc* descs = static_cast<xdp_desc*>(tx_.descs);
+	std::optional<UDPError> error;
+	size_t sent = 0;
+	for(; sent < count; ++sent)
+	{
+		const DatagramView& d = datagrams[sent];
+		size_t size = d.headerSize + d.payloadSize + d.trailerSize;
+		if(HEADERS + size > config_.frameSize)
+		{
+			error = UDPError::MESSAGE_TOO_LARGE;
+			break;
+		}
+
+		uint32_t destination = ip.toNet();
+		uint16_t destinationPort = config_.port;
+		if(destinations)
+		{
+			std::optional<IPAddress> v4 = destinations[sent].ip.toV4();
+			if(!v4)
+			{
+				error = UDPError::OPERATION_NOT_SUPPORTED;
+				break;
+			}
+			destination = v4->toNet();
+			destinationPort = destinations[sent].port;
+		}
+		uint8_t mac[6];
+		if(!resolve(destination, mac))
+		{
+			error = UDPError::ADDRESS_NOT_AVAILABLE;
+			break;
+		}
+
+		if(freeFrames_.empty() || producer - loadAcquire(tx_.consumer) >= tx_.size)
+		{
+			kickTx();
+			reclaim();
+			if(freeFrames_.empty() || producer - loadAcquire(tx_.consumer) >= tx_.size)
+			{
+				error = UDPError::WOULD_BLOCK;
+				break;
+			}
+		}
+		uint64_t frame = freeFrames_.back();
+		freeFrames_.pop_back();
+
+		uint8_t* out = umem_ + frame;
+		memcpy(out, mac, 6);
+		memcpy(out + 6, mac_.data(), 6);
+		putU16(out + 12, ETH_P_IP);
+
+		uint8_t* iph = out + ETH_HEADER;
+		iph[0] = 0x45;
+		iph[1] = 0;
+		putU16(iph + 2, static_cast<uint16_t>(IP_HEADER + UDP_HEADER + size));
+		putU16(iph + 4, ipId_++);
+		putU16(iph + 6, 0x4000); // DF
+		iph[8] = IPAddress::fromNet(destination).isMulticast() ? 1 : 64;
+		iph[9] = IPPROTO_UDP;
+		putU16(iph + 10, 0);
+		memcpy(iph + 12, &ip_, 4);
+		memcpy(iph + 16, &destination, 4);
+		putU16(iph + 10, ipChecksum(iph));
+
+		uint8_t* udph = iph + IP_HEADER;
+		memcpy(udph, &port_, 2);
+		putU16(udph + 2, destinationPort);
+		putU16(udph + 4, static_cast<uint16_t>(UDP_HEADER + size));
+		putU16(udph + 6, 0); // контрольная сумма UDP в IPv4 необязательна
+
+		uint8_t* data = udph + UDP_HEADER;
+		if(d.headerSize)
+			memcpy(data, d.header, d.headerSize);
+		if(d.payloadSize)
+			memcpy(data + d.headerSize, d.payload, d.payloadSize);
+		if(d.trailerSize)
+			memcpy(data + d.headerSize + d.payloadSize, d.trailer, d.trailerSize);
+
+		xdp_desc& desc = descs[producer & tx_.mask];
+		desc.addr = frame;
+		desc.len = static_cast<uint32_t>(HEADERS + size);
+		desc.options = 0;
+		++producer;
+	}
+	if(sent > 0)
+	{
+		storeRelease(tx_.producer, producer);
+		kickTx();
+	}
+	if(error && sent == 0)
+		return error.value();
+	return sent;
+}
+
+std::variant<size_t, UDPError> XdpTransport::send_batch(const DatagramView* datagrams, size_t count, IPAddress ip)
+{
+	return send(datagrams, nullptr, count, ip);
+}
+
+std::variant<size_t, UDPError> XdpTransport::send_batch(const DatagramView* datagrams, const Endpoint* destinations, size_t count)
+{
+	return send(datagrams, destinations, count, IP_ANY);
+}
+
+std::variant<ReceiveInfo, UDPError> XdpTransport::recieve(uint8_t* buf, size_t size)
+{
+	for(;;)
+	{
+		uint32_t consumer = *rx_.consumer;
+		if(consumer == loadAcquire(rx_.producer))
+		{
+			if(loadAcquire(fill_.flags) & XDP_RING_NEED_WAKEUP)
+				recvfrom(socket_, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+			return RECEIVE_NONE;
+		}
+		const xdp_desc desc = static_cast<const xdp_desc*>(rx_.descs)[consumer & rx_.mask];
+		storeRelease(rx_.consumer, consumer + 1);
+
+		const uint8_t* frame = umem_ + desc.addr;
+		std::optional<ReceiveInfo> info;
+		if(desc.len >= HEADERS && getU16(frame + 12) == ETH_P_IP && frame[ETH_HEADER] == 0x45
+			&& frame[ETH_HEADER + 9] == IPPROTO_UDP)
+		{
+			const uint8_t* udph = frame + ETH_HEADER + IP_HEADER;
+			size_t length = getU16(udph + 4); // по длине UDP: короткие кадры Ethernet дополнены нулями
+			if(length >= UDP_HEADER && HEADERS + length - UDP_HEADER <= desc.len)
+			{
+				length -= UDP_HEADER;
+				size_t copied = length < size ? length : size; // лишнее отрезается, как у recvfrom
+				memcpy(buf, udph + UDP_HEADER, copied);
+
+				uint32_t source;
+				memcpy(&source, frame + ETH_HEADER + 12, 4);
+				std::array<uint8_t, 6> mac;
+				memcpy(mac.data(), frame + 6, 6);
+				if(!(mac[0] & 1))
+					neighbours_[source] = mac;
+				IPAddress sourceIP = IPAddress::fromNet(source);
+				info = ReceiveInfo(copied, sourceIP, getU16(udph), NetAddress(sourceIP));
+			}
+		}
+
+		// кадр сразу возвращается ядру для следующего приёма
+		uint32_t fillProducer = *fill_.producer;
+		static_cast<uint64_t*>(fill_.descs)[fillProducer & fill_.mask] = desc.addr & ~static_cast<uint64_t>(config_.frameSize - 1);
+		storeRelease(fill_.producer, fillProducer + 1);
+
+		if(info)
+			return info.value();
+		++rxDropped_;
+	}
+}